@@ -0,0 +1,942 @@
+#include "arena.hpp"
+#include "connection_group.hpp"
+#include "emitter.hpp"
+#include "queued_signal.hpp"
+#include "result_signal.hpp"
+#include "signal.hpp"
+#include "slot.hpp"
+#include "static_signal.hpp"
+#include "thread_pool_executor.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Count every heap allocation, so that each benchmark can report how many
+// allocations it makes per operation.
+static std::atomic<std::size_t> allocation_count{0};
+
+// GCC sees free() being called on memory from operator new wherever these
+// are inlined, and warns that the two don't match. They do match here, since
+// both are replaced, so the warning is suppressed for the replacements.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Records the allocation count when constructed, and reports the number of
+// allocations per iteration when destroyed.
+class allocation_counter
+{
+public:
+  explicit allocation_counter(benchmark::State& state)
+    : state(state)
+    , start(allocation_count.load(std::memory_order_relaxed))
+  { }
+
+  ~allocation_counter()
+  {
+    auto allocations = allocation_count.load(std::memory_order_relaxed) - start;
+    state.counters["allocs/op"] = benchmark::Counter(
+      static_cast<double>(allocations),
+      benchmark::Counter::kAvgIterations);
+  }
+
+private:
+  benchmark::State& state;
+  std::size_t start;
+};
+
+// An executor which collects closures and runs them in a batch.
+class batch_executor
+{
+public:
+  void submit(std::function<void()> closure)
+  {
+    closures.push_back(std::move(closure));
+  }
+
+  void run()
+  {
+    for (auto& closure : closures)
+      closure();
+    closures.clear();
+  }
+
+private:
+  std::vector<std::function<void()>> closures;
+};
+
+// A naive thread pool, with a single queue guarded by a mutex, to compare
+// against bb::thread_pool_executor.
+class mutex_pool
+{
+public:
+  explicit mutex_pool(std::size_t count)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      threads.emplace_back([this]{ run(); });
+  }
+
+  ~mutex_pool()
+  {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  void submit(std::function<void()> closure)
+  {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      closures.push_back(std::move(closure));
+    }
+    condition.notify_one();
+  }
+
+private:
+  void run()
+  {
+    while (true)
+    {
+      std::function<void()> closure;
+      {
+        std::unique_lock<std::mutex> lock{mutex};
+        condition.wait(lock, [this]{ return stopping || !closures.empty(); });
+        if (closures.empty())
+          return;
+        closure = std::move(closures.front());
+        closures.pop_front();
+      }
+      closure();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::function<void()>> closures;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+};
+
+// Waits until a number of closures have run.
+class countdown
+{
+public:
+  explicit countdown(int count)
+    : remaining{count}
+  { }
+
+  void decrement()
+  {
+    remaining.fetch_sub(1, std::memory_order_release);
+  }
+
+  void wait()
+  {
+    while (remaining.load(std::memory_order_acquire) > 0)
+      std::this_thread::yield();
+  }
+
+private:
+  std::atomic<int> remaining;
+};
+
+// A payload which is expensive to copy.
+struct heavy
+{
+  std::array<char, 4096> data{};
+};
+
+template <class Policy, class... Params>
+struct basic_fixture
+{
+  basic_fixture()
+  {
+    bb::connect(emit, signal);
+  }
+
+  template <class Fn>
+  void add_slots(int count, Fn fn)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      bb::basic_slot<Policy, Params...> slot{fn};
+      bb::connect(signal, slot);
+      slots.push_back(std::move(slot));
+    }
+  }
+
+  template <class Executor, class Fn>
+  void add_slots(int count, Executor& executor, Fn fn)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      bb::basic_slot<Policy, Params...> slot{executor, fn};
+      bb::connect(signal, slot);
+      slots.push_back(std::move(slot));
+    }
+  }
+
+  bb::basic_emitter<Policy, Params...> emit;
+  bb::basic_signal<Policy, Params...> signal;
+  std::vector<bb::basic_slot<Policy, Params...>> slots;
+};
+
+template <class... Params>
+using fixture = basic_fixture<bb::multi_threaded, Params...>;
+
+//------------------------------------------------------------------------------
+
+void emit_trivial(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit(1);
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_trivial)->Arg(0)->Arg(1)->Arg(10)->Arg(1000);
+
+void emit_heavy_copy(benchmark::State& state)
+{
+  fixture<heavy> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](const heavy& value){ benchmark::DoNotOptimize(&value); });
+
+  heavy payload;
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit(payload);
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_heavy_copy)->Arg(0)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emits an rvalue which is cheap to move but expensive to copy.
+void emit_movable(benchmark::State& state)
+{
+  fixture<std::vector<char>> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](std::vector<char> value){ benchmark::DoNotOptimize(&value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    std::vector<char> payload(4096);
+    state.ResumeTiming();
+    f.emit.emit_to_last(std::move(payload));
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_movable)->Arg(0)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emits a move-only argument, which is moved into the last connected slot.
+void emit_move_only(benchmark::State& state)
+{
+  fixture<std::unique_ptr<int>> f;
+  f.add_slots(1, [](std::unique_ptr<int> value)
+                 { benchmark::DoNotOptimize(value.get()); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    auto payload = std::make_unique<int>(1);
+    state.ResumeTiming();
+    f.emit.emit_to_last(std::move(payload));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(emit_move_only);
+
+void emit_executor(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)), executor,
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    f.emit(1);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_executor)->Arg(0)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emits to N slots on the thread which owns a queued signal, to compare with
+// submitting a closure per slot to an executor.
+void emit_queued(benchmark::State& state)
+{
+  bb::queued_signal<int> queued;
+  bb::emitter<int> emit_signal;
+  bb::connect(emit_signal, queued);
+
+  std::vector<bb::queued_signal<int>::slot_t> slots;
+  for (int i = 0; i < state.range(0); ++i)
+  {
+    bb::queued_signal<int>::slot_t slot{
+      [](int value){ benchmark::DoNotOptimize(value); }};
+    bb::connect(queued.signal(), slot);
+    slots.push_back(std::move(slot));
+  }
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    emit_signal(1);
+    queued.poll();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_queued)->Arg(0)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emits a payload which is expensive to copy to N slots with an executor,
+// each of which captures its own copy.
+void emit_heavy_executor(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<const heavy&> f;
+  f.add_slots(static_cast<int>(state.range(0)), executor,
+              [](const heavy& value){ benchmark::DoNotOptimize(&value); });
+
+  heavy payload;
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    f.emit(payload);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_heavy_executor)->Arg(1)->Arg(10)->Arg(1000);
+
+// As above, but the payload is copied once and shared by every slot.
+void emit_heavy_shared(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<const heavy&> f;
+  f.add_slots(static_cast<int>(state.range(0)), executor,
+              [](const heavy& value){ benchmark::DoNotOptimize(&value); });
+
+  heavy payload;
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    f.emit.emit_shared(payload);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(emit_heavy_shared)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emitting a burst of 64 events to a slow consumer, which only runs its
+// executor once per burst, with an ordinary, a conflated and a bounded slot.
+void emit_burst_executor(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<int> f;
+  f.add_slots(1, executor, [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    for (int i = 0; i < 64; ++i)
+      f.emit(i);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(emit_burst_executor);
+
+void emit_burst_conflated(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<int> f;
+  bb::slot<int> slot{bb::conflated, executor,
+                     [](int value){ benchmark::DoNotOptimize(value); }};
+  bb::connect(f.signal, slot);
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    for (int i = 0; i < 64; ++i)
+      f.emit(i);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(emit_burst_conflated);
+
+void emit_burst_bounded(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<int> f;
+  bb::slot<int> slot{bb::bounded(64), executor,
+                     [](int value){ benchmark::DoNotOptimize(value); }};
+  bb::connect(f.signal, slot);
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    for (int i = 0; i < 64; ++i)
+      f.emit(i);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(emit_burst_bounded);
+
+// Emitting a burst of 64 events to N slots in one batch.
+void emit_batch_trivial(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  std::vector<int> events(64, 1);
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit.emit_batch(events);
+
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 64);
+}
+BENCHMARK(emit_batch_trivial)->Arg(1)->Arg(10)->Arg(1000);
+
+void emit_batch_executor(benchmark::State& state)
+{
+  batch_executor executor;
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)), executor,
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  std::vector<int> events(64, 1);
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    f.emit.emit_batch(events);
+    executor.run();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 64);
+}
+BENCHMARK(emit_batch_executor)->Arg(1)->Arg(10)->Arg(1000);
+
+// Several threads emitting the same signal at once.
+void emit_contended(benchmark::State& state)
+{
+  struct shared_fixture : fixture<int>
+  {
+    shared_fixture()
+    {
+      add_slots(10, [](int value){ benchmark::DoNotOptimize(value); });
+    }
+  };
+
+  static shared_fixture f;
+
+  for (auto _ : state)
+    f.emit(1);
+
+  state.SetItemsProcessed(state.iterations() * 10);
+}
+BENCHMARK(emit_contended)->ThreadRange(1, 8)->UseRealTime();
+
+// Several threads emitting the same signal at once, to reentrant slots which
+// don't serialize their invocations.
+void emit_contended_reentrant(benchmark::State& state)
+{
+  struct shared_fixture : fixture<int>
+  {
+    shared_fixture()
+    {
+      for (int i = 0; i < 10; ++i)
+      {
+        bb::slot<int> slot{bb::reentrant,
+                           [](int value){ benchmark::DoNotOptimize(value); }};
+        bb::connect(signal, slot);
+        slots.push_back(std::move(slot));
+      }
+    }
+  };
+
+  static shared_fixture f;
+
+  for (auto _ : state)
+    f.emit(1);
+
+  state.SetItemsProcessed(state.iterations() * 10);
+}
+BENCHMARK(emit_contended_reentrant)->ThreadRange(1, 8)->UseRealTime();
+
+// Several threads emitting the same signal through their own copies of an
+// emitter, to a single reentrant slot, so that the cost of checking the
+// signal is still alive dominates. Pinned emitters check with a plain load,
+// unpinned ones lock a weak reference.
+template <bool Pinned>
+void emit_scaling(benchmark::State& state)
+{
+  struct shared_fixture : fixture<int>
+  {
+    shared_fixture()
+    {
+      bb::slot<int> slot{bb::reentrant,
+                         [](int value){ benchmark::DoNotOptimize(value); }};
+      bb::connect(signal, slot);
+      slots.push_back(std::move(slot));
+    }
+  };
+
+  static shared_fixture f;
+
+  auto emit_signal = f.emit;
+  if (Pinned)
+    emit_signal.pin();
+
+  for (auto _ : state)
+    emit_signal(1);
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(emit_scaling, false)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(emit_scaling, true)->ThreadRange(1, 16)->UseRealTime();
+
+// Submitting 1000 closures to a pool of 4 workers from outside the pool.
+template <class Pool>
+void pool_submit(benchmark::State& state)
+{
+  Pool pool{4};
+
+  for (auto _ : state)
+  {
+    countdown done{1000};
+    for (int i = 0; i < 1000; ++i)
+      pool.submit([&done]{ done.decrement(); });
+    done.wait();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK_TEMPLATE(pool_submit, mutex_pool)->UseRealTime();
+BENCHMARK_TEMPLATE(pool_submit, bb::thread_pool_executor)->UseRealTime();
+
+// Submitting 1000 closures from inside a pool of 4 workers, as a slot does
+// when it emits another signal.
+template <class Pool>
+void pool_submit_nested(benchmark::State& state)
+{
+  Pool pool{4};
+
+  for (auto _ : state)
+  {
+    countdown done{1000};
+    pool.submit([&pool, &done]
+    {
+      for (int i = 0; i < 1000; ++i)
+        pool.submit([&done]{ done.decrement(); });
+    });
+    done.wait();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK_TEMPLATE(pool_submit_nested, mutex_pool)->UseRealTime();
+BENCHMARK_TEMPLATE(pool_submit_nested, bb::thread_pool_executor)
+  ->UseRealTime();
+
+// Emitting to N slots which run on a pool of 4 workers.
+template <class Pool>
+void emit_pool(benchmark::State& state)
+{
+  Pool pool{4};
+  countdown* done = nullptr;
+
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)), pool,
+              [&done](int){ done->decrement(); });
+
+  for (auto _ : state)
+  {
+    countdown emitted{static_cast<int>(state.range(0))};
+    done = &emitted;
+    f.emit(1);
+    emitted.wait();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(emit_pool, mutex_pool)->Arg(10)->Arg(1000)->UseRealTime();
+BENCHMARK_TEMPLATE(emit_pool, bb::thread_pool_executor)
+  ->Arg(10)->Arg(1000)->UseRealTime();
+
+// Emitting to N inline slots with each threading policy.
+template <class Policy>
+void emit_policy(benchmark::State& state)
+{
+  basic_fixture<Policy, int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit(1);
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(emit_policy, bb::multi_threaded)
+  ->Arg(1)->Arg(10)->Arg(1000);
+BENCHMARK_TEMPLATE(emit_policy, bb::single_threaded)
+  ->Arg(1)->Arg(10)->Arg(1000);
+
+// A static slot which consumes its argument.
+struct static_sink
+{
+  void operator()(int value) const
+  {
+    benchmark::DoNotOptimize(value);
+  }
+};
+
+template <std::size_t>
+using indexed_sink = static_sink;
+
+template <std::size_t... I>
+void emit_static(benchmark::State& state, std::index_sequence<I...>)
+{
+  bb::static_emitter<indexed_sink<I>...> emit;
+  bb::static_signal<indexed_sink<I>...> signal;
+  bb::connect(emit, signal);
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    emit(1);
+
+  state.SetItemsProcessed(
+    state.iterations() * static_cast<std::int64_t>(sizeof...(I)));
+}
+
+// Emitting to N static slots, for comparison with emit_policy.
+template <std::size_t N>
+void emit_static(benchmark::State& state)
+{
+  emit_static(state, std::make_index_sequence<N>{});
+}
+BENCHMARK_TEMPLATE(emit_static, 1);
+BENCHMARK_TEMPLATE(emit_static, 10);
+
+// Emitting to a high-priority short-circuiting slot which handles every event,
+// ahead of N ordinary slots which therefore never run.
+void emit_short_circuit(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  bb::slot<int> handler{bb::short_circuit, [](int value)
+  {
+    benchmark::DoNotOptimize(value);
+    return true;
+  }};
+  bb::connect(f.signal, handler, bb::priority{1});
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit(1);
+}
+BENCHMARK(emit_short_circuit)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emitting to N result slots and folding their results.
+void emit_combine(benchmark::State& state)
+{
+  bb::emitter<int(int)> emit_signal;
+  bb::signal<int(int)> signal;
+  bb::connect(emit_signal, signal);
+
+  std::deque<bb::slot<int(int)>> slots;
+  for (int i = 0; i < state.range(0); ++i)
+  {
+    slots.emplace_back([i](int value){ return value + i; });
+    bb::connect(signal, slots.back());
+  }
+
+  auto sum = [](int total, int value){ return total + value; };
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+      emit_signal.combine(bb::combiners::fold(0, sum), 1));
+}
+BENCHMARK(emit_combine)->Arg(1)->Arg(10)->Arg(1000);
+
+// Emitting to N signals, each with one slot, through relay slots on a first
+// signal which re-emit to each of the others.
+void emit_relay(benchmark::State& state)
+{
+  fixture<int> f;
+  std::deque<fixture<int>> targets(static_cast<std::size_t>(state.range(0)));
+  for (auto& target : targets)
+  {
+    target.add_slots(1, [](int value){ benchmark::DoNotOptimize(value); });
+    f.add_slots(1, [&target](int value){ target.emit(value); });
+  }
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    f.emit(1);
+}
+BENCHMARK(emit_relay)->Arg(1)->Arg(10)->Arg(100);
+
+// Emitting to N signals, each with one slot, with an emitter joined to all of
+// them.
+void emit_joined(benchmark::State& state)
+{
+  bb::emitter<int> emit_signal;
+  std::deque<fixture<int>> targets(static_cast<std::size_t>(state.range(0)));
+  for (auto& target : targets)
+  {
+    target.add_slots(1, [](int value){ benchmark::DoNotOptimize(value); });
+    bb::connect(emit_signal, target.signal, bb::join);
+  }
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+    emit_signal(1);
+}
+BENCHMARK(emit_joined)->Arg(1)->Arg(10)->Arg(100);
+
+// Emitting to N CPU-heavy slots, one after another or in parallel on the
+// default pool.
+template <bool Parallel>
+void emit_heavy_slots(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)), [](int value)
+  {
+    for (int i = 0; i < 1000; ++i)
+      benchmark::DoNotOptimize(value += i);
+  });
+
+  for (auto _ : state)
+  {
+    if (Parallel)
+      f.emit.emit_parallel(bb::default_thread_pool(), 1);
+    else
+      f.emit(1);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(emit_heavy_slots, false)->Arg(100)->Arg(10000)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(emit_heavy_slots, true)->Arg(100)->Arg(10000)
+  ->UseRealTime();
+
+// Connecting and destroying a slot with each threading policy.
+template <class Policy>
+void connect_disconnect_policy(benchmark::State& state)
+{
+  basic_fixture<Policy, int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    {
+      bb::basic_slot<Policy, int> slot{
+        [](int value){ benchmark::DoNotOptimize(value); }};
+      bb::connect(f.signal, slot);
+    }
+    f.emit(1);
+  }
+}
+BENCHMARK_TEMPLATE(connect_disconnect_policy, bb::multi_threaded)
+  ->Arg(0)->Arg(10);
+BENCHMARK_TEMPLATE(connect_disconnect_policy, bb::single_threaded)
+  ->Arg(0)->Arg(10);
+
+// Connecting and destroying a slot on a signal which already has N slots.
+void connect_disconnect(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    bb::slot<int> slot{[](int value){ benchmark::DoNotOptimize(value); }};
+    bb::connect(f.signal, slot);
+  }
+}
+BENCHMARK(connect_disconnect)->Arg(0)->Arg(10)->Arg(1000);
+
+// Connecting and destroying a slot, with all of the state in an arena.
+void connect_disconnect_arena(benchmark::State& state)
+{
+  bb::arena arena;
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(std::allocator_arg, arena, emit_signal, signal);
+
+  std::deque<bb::slot<int>> slots;
+  for (int i = 0; i < state.range(0); ++i)
+  {
+    slots.emplace_back(std::allocator_arg, arena,
+                       [](int value){ benchmark::DoNotOptimize(value); });
+    bb::connect(signal, slots.back());
+  }
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    bb::slot<int> slot{std::allocator_arg, arena,
+                       [](int value){ benchmark::DoNotOptimize(value); }};
+    bb::connect(signal, slot);
+  }
+}
+BENCHMARK(connect_disconnect_arena)->Arg(0)->Arg(10)->Arg(1000);
+
+// Connecting a function and disconnecting it through its handle, on a signal
+// which already has N slots.
+void connect_function_disconnect(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    auto connection = bb::connect(
+      f.signal, [](int value){ benchmark::DoNotOptimize(value); });
+    f.emit(1);
+    connection.disconnect();
+  }
+}
+BENCHMARK(connect_function_disconnect)->Arg(0)->Arg(10)->Arg(1000);
+
+// Connecting, destroying and emitting, so that tombstones are compacted.
+void connect_disconnect_emit(benchmark::State& state)
+{
+  fixture<int> f;
+  f.add_slots(static_cast<int>(state.range(0)),
+              [](int value){ benchmark::DoNotOptimize(value); });
+
+  allocation_counter allocations{state};
+  for (auto _ : state)
+  {
+    {
+      bb::slot<int> slot{[](int value){ benchmark::DoNotOptimize(value); }};
+      bb::connect(f.signal, slot);
+    }
+    f.emit(1);
+  }
+}
+BENCHMARK(connect_disconnect_emit)->Arg(0)->Arg(10)->Arg(1000);
+
+// Tearing down N connected functions, either as slots destroyed one by one or
+// as a connection group disconnected at once, followed by the emit which
+// compacts the signal.
+template <bool Grouped>
+void teardown(benchmark::State& state)
+{
+  fixture<int> f;
+  bb::connection_group group;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    for (int i = 0; i < state.range(0); ++i)
+    {
+      if (Grouped)
+        bb::connect(f.signal,
+                    [](int value){ benchmark::DoNotOptimize(value); }, group);
+      else
+        f.add_slots(1, [](int value){ benchmark::DoNotOptimize(value); });
+    }
+    state.ResumeTiming();
+
+    if (Grouped)
+      group.disconnect();
+    else
+      f.slots.clear();
+    f.emit(1);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(teardown, false)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK_TEMPLATE(teardown, true)->Arg(10)->Arg(100)->Arg(1000);
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+BENCHMARK_MAIN();
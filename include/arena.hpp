@@ -0,0 +1,224 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "memory_resource.hpp"
+#include "threading.hpp"
+#include "detail/threading.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <mutex>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A memory resource for a whole connection graph, such as everything
+/// belonging to one session. Small blocks are carved from large chunks and
+/// recycled through free lists by size, so connecting and disconnecting
+/// doesn't touch the global heap once the arena has warmed up, and destroying
+/// the arena returns all of its chunks at once.
+/// \tparam Policy The threading policy: multi_threaded arenas lock on each
+/// allocation, single_threaded ones don't.
+/// \note The arena must outlive the signals, slots and connections which use
+/// it.
+///
+template <class Policy>
+class basic_arena final : public memory_resource
+{
+public:
+  ///
+  /// \brief Construct an empty arena.
+  /// \param chunk_size The number of bytes to request from upstream at a
+  /// time.
+  /// \param upstream The resource from which the chunks, and any blocks too
+  /// large to pool, are allocated.
+  ///
+  explicit basic_arena(std::size_t chunk_size = 64 * 1024,
+                       memory_resource* upstream = new_delete_resource());
+
+  ///
+  /// \brief Deleted copy constructor.
+  ///
+  basic_arena(const basic_arena&) = delete;
+
+  ///
+  /// \brief Deleted copy assignment operator.
+  ///
+  basic_arena& operator=(const basic_arena&) = delete;
+
+  ///
+  /// \brief Return every chunk to the upstream resource.
+  ///
+  ~basic_arena() override;
+
+  ///
+  /// \brief The number of bytes held in chunks from the upstream resource.
+  ///
+  std::size_t reserved() const;
+
+private:
+  using mutex_t = typename detail::threading<Policy>::mutex_t;
+
+  struct chunk
+  {
+    chunk* next;
+    std::size_t size;
+  };
+
+  struct free_block
+  {
+    free_block* next;
+  };
+
+  // Blocks are pooled in power of two sizes from min_block to max_block.
+  static constexpr std::size_t min_block = 16;
+  static constexpr std::size_t max_block = 16 * 1024;
+  static constexpr std::size_t size_classes = 11;
+  static constexpr std::size_t chunk_header =
+    (sizeof(chunk) + alignof(std::max_align_t) - 1) &
+    ~(alignof(std::max_align_t) - 1);
+
+  static_assert(min_block % alignof(std::max_align_t) == 0,
+                "blocks must be carved at the maximum alignment");
+
+  static std::size_t size_class(std::size_t bytes);
+
+  static bool is_pooled(std::size_t bytes, std::size_t alignment)
+  {
+    return bytes <= max_block && alignment <= alignof(std::max_align_t);
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(const memory_resource& other) const noexcept override;
+
+  // Must be called with the mutex held.
+  void* carve(std::size_t bytes);
+
+  memory_resource* const upstream;
+  const std::size_t chunk_size;
+  mutable mutex_t mutex;
+  chunk* chunks = nullptr;
+  char* cursor = nullptr;
+  char* end = nullptr;
+  std::size_t reserved_bytes = 0;
+  std::array<free_block*, size_classes> free_lists{};
+};
+
+///
+/// \brief An arena which may be used from any thread.
+///
+using arena = basic_arena<multi_threaded>;
+
+//------------------------------------------------------------------------------
+
+template <class Policy>
+basic_arena<Policy>::basic_arena(std::size_t chunk_size,
+                                 memory_resource* upstream)
+  : upstream(upstream)
+  , chunk_size(std::max(chunk_size, chunk_header + max_block))
+{
+}
+
+template <class Policy>
+basic_arena<Policy>::~basic_arena()
+{
+  while (chunks)
+  {
+    chunk* next = chunks->next;
+    upstream->deallocate(chunks, chunks->size, alignof(std::max_align_t));
+    chunks = next;
+  }
+}
+
+template <class Policy>
+std::size_t basic_arena<Policy>::reserved() const
+{
+  std::unique_lock<mutex_t> lock{mutex};
+  return reserved_bytes;
+}
+
+template <class Policy>
+std::size_t basic_arena<Policy>::size_class(std::size_t bytes)
+{
+  std::size_t index = 0;
+  for (std::size_t size = min_block; size < bytes; size *= 2)
+    ++index;
+  return index;
+}
+
+template <class Policy>
+void* basic_arena<Policy>::do_allocate(std::size_t bytes,
+                                       std::size_t alignment)
+{
+  if (!is_pooled(bytes, alignment))
+    return upstream->allocate(bytes, alignment);
+
+  auto index = size_class(bytes);
+
+  std::unique_lock<mutex_t> lock{mutex};
+  if (free_block* block = free_lists[index])
+  {
+    free_lists[index] = block->next;
+    return block;
+  }
+
+  return carve(min_block << index);
+}
+
+template <class Policy>
+void basic_arena<Policy>::do_deallocate(void* p, std::size_t bytes,
+                                        std::size_t alignment)
+{
+  if (!is_pooled(bytes, alignment))
+  {
+    upstream->deallocate(p, bytes, alignment);
+    return;
+  }
+
+  auto index = size_class(bytes);
+
+  std::unique_lock<mutex_t> lock{mutex};
+  free_lists[index] = ::new (p) free_block{free_lists[index]};
+}
+
+template <class Policy>
+bool basic_arena<Policy>::do_is_equal(
+  const memory_resource& other) const noexcept
+{
+  return this == &other;
+}
+
+template <class Policy>
+void* basic_arena<Policy>::carve(std::size_t bytes)
+{
+  // Every block size is a multiple of the maximum alignment, so blocks
+  // carved in sequence stay aligned. Whatever is left at the end of a chunk
+  // is abandoned when the next one is started.
+  if (static_cast<std::size_t>(end - cursor) < bytes)
+  {
+    void* memory = upstream->allocate(chunk_size, alignof(std::max_align_t));
+    chunks = ::new (memory) chunk{chunks, chunk_size};
+    cursor = static_cast<char*>(memory) + chunk_header;
+    end = static_cast<char*>(memory) + chunk_size;
+    reserved_bytes += chunk_size;
+  }
+
+  void* block = cursor;
+  cursor += bytes;
+  return block;
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // ARENA_HPP
@@ -0,0 +1,198 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "tags.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A view of a contiguous sequence of events, which is delivered to
+/// batch-aware slots.
+/// \tparam Params... The signal parameters. Each event is a tuple of their
+/// decayed types.
+///
+template <class... Params>
+class batch
+{
+public:
+  ///
+  /// \brief The type of each event in the batch.
+  ///
+  using value_type = std::tuple<typename std::decay<Params>::type...>;
+  using const_iterator = const value_type*;
+
+  ///
+  /// \brief Construct a view of count events starting at first.
+  ///
+  batch(const value_type* first, std::size_t count)
+    : first{first}
+    , count{count}
+  { }
+
+  const_iterator begin() const { return first; }
+  const_iterator end() const { return first + count; }
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const value_type& operator[](std::size_t i) const { return first[i]; }
+
+private:
+  const value_type* first;
+  std::size_t count;
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+template <class Fn, class Tuple, std::size_t... I>
+decltype(auto) apply_tuple(Fn& fn, const Tuple& tuple,
+                           std::index_sequence<I...>)
+{
+  return fn(std::get<I>(tuple)...);
+}
+
+///
+/// \brief Invoke fn with the elements of a tuple of arguments, and return its
+/// result.
+///
+template <class Fn, class Tuple>
+decltype(auto) apply_tuple(Fn& fn, const Tuple& tuple)
+{
+  return apply_tuple(
+    fn, tuple, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+}
+
+///
+/// \brief Invoke fn with an element of a range passed to emit_batch(). Signals
+/// with a single parameter take the element itself; otherwise the element is
+/// a tuple of the arguments.
+///
+template <std::size_t Arity, class Fn, class Event>
+typename std::enable_if<Arity == 1>::type
+apply_event(Fn& fn, const Event& event)
+{
+  fn(event);
+}
+
+template <std::size_t Arity, class Fn, class Event>
+typename std::enable_if<Arity != 1>::type
+apply_event(Fn& fn, const Event& event)
+{
+  apply_tuple(fn, event);
+}
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The events passed to a single emit_batch() call. The events are
+/// only copied into contiguous, shared storage if a slot needs it, and then
+/// only once for all slots.
+///
+template <class Range, class... Params>
+class batch_source
+{
+public:
+  using batch_t = batch<Params...>;
+  using event_t = typename batch_t::value_type;
+  using events_t = std::vector<event_t>;
+  using shared_events_t = std::shared_ptr<const events_t>;
+
+  explicit batch_source(const Range& range)
+    : events{range}
+  { }
+
+  const Range& range() const
+  {
+    return events;
+  }
+
+  ///
+  /// \brief The events as a shared vector, which can outlive the emit.
+  ///
+  const shared_events_t& shared() const
+  {
+    if (!shared_events)
+    {
+      auto copy = std::make_shared<events_t>();
+      copy->reserve(static_cast<std::size_t>(
+        std::distance(std::begin(events), std::end(events))));
+      for (const auto& event : events)
+        copy->emplace_back(event);
+      shared_events = std::move(copy);
+    }
+    return shared_events;
+  }
+
+  ///
+  /// \brief The events as a contiguous view, valid for the duration of the
+  /// emit.
+  ///
+  batch_t view() const
+  {
+    return view(std::is_same<Range, events_t>{});
+  }
+
+  ///
+  /// \brief Invoke fn with one of the events in the range. A vector of the
+  /// batch's own event tuples is unpacked whatever the arity, so that it can
+  /// also be viewed without a copy.
+  ///
+  template <class Fn, class Event>
+  static void apply(Fn& fn, const Event& event)
+  {
+    apply(fn, event, std::is_same<Range, events_t>{});
+  }
+
+private:
+  template <class Fn>
+  static void apply(Fn& fn, const event_t& event, std::true_type)
+  {
+    apply_tuple(fn, event);
+  }
+
+  template <class Fn, class Event>
+  static void apply(Fn& fn, const Event& event, std::false_type)
+  {
+    apply_event<sizeof...(Params)>(fn, event);
+  }
+
+  batch_t view(std::true_type) const
+  {
+    return batch_t{events.data(), events.size()};
+  }
+
+  batch_t view(std::false_type) const
+  {
+    const events_t& copy = *shared();
+    return batch_t{copy.data(), copy.size()};
+  }
+
+  const Range& events;
+  mutable shared_events_t shared_events;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // BATCH_HPP
@@ -0,0 +1,192 @@
+#ifndef COMBINERS_HPP
+#define COMBINERS_HPP
+
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Combiners for the results of the slots connected to a signal with a
+/// non-void signature, see result_signal.hpp.
+///
+/// A combiner is called with each slot's result in turn, in the order the
+/// slots are invoked, and returns whether the emit should continue to the
+/// next slot. Once the emit has finished, result() returns the combined
+/// value.
+///
+namespace combiners {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Combines the results into the last one.
+///
+template <class R>
+class last
+{
+public:
+  using result_type = R;
+
+  ///
+  /// \brief Construct a combiner.
+  /// \param initial The result if no slots are invoked.
+  ///
+  explicit last(R initial = R{})
+    : value(std::move(initial))
+  { }
+
+  bool operator()(R result)
+  {
+    value = std::move(result);
+    return true;
+  }
+
+  R result()
+  {
+    return std::move(value);
+  }
+
+private:
+  R value;
+};
+
+///
+/// \brief Takes the first result, and stops the emit there.
+///
+template <class R>
+class first
+{
+public:
+  using result_type = R;
+
+  ///
+  /// \brief Construct a combiner.
+  /// \param initial The result if no slots are invoked.
+  ///
+  explicit first(R initial = R{})
+    : value(std::move(initial))
+  { }
+
+  bool operator()(R result)
+  {
+    value = std::move(result);
+    return false;
+  }
+
+  R result()
+  {
+    return std::move(value);
+  }
+
+private:
+  R value;
+};
+
+///
+/// \brief Collects every result, in order.
+///
+template <class R>
+class vector
+{
+public:
+  using result_type = std::vector<R>;
+
+  bool operator()(R result)
+  {
+    values.push_back(std::move(result));
+    return true;
+  }
+
+  std::vector<R> result()
+  {
+    return std::move(values);
+  }
+
+private:
+  std::vector<R> values;
+};
+
+///
+/// \brief Folds the results into an accumulated value.
+///
+template <class R, class Op>
+class fold_t
+{
+public:
+  using result_type = R;
+
+  fold_t(R initial, Op op)
+    : value(std::move(initial))
+    , op(std::move(op))
+  { }
+
+  template <class T>
+  bool operator()(T&& result)
+  {
+    value = op(std::move(value), std::forward<T>(result));
+    return true;
+  }
+
+  R result()
+  {
+    return std::move(value);
+  }
+
+private:
+  R value;
+  Op op;
+};
+
+///
+/// \brief Fold the results with a binary operation, e.g.
+/// `fold(0, [](int a, int b) { return std::max(a, b); })`.
+/// \param initial The initial value, which is the result if no slots are
+/// invoked.
+/// \param op The operation, which is called with the accumulated value and
+/// each result in turn and returns the new accumulated value.
+///
+template <class R, class Op>
+fold_t<R, Op> fold(R initial, Op op)
+{
+  return fold_t<R, Op>{std::move(initial), std::move(op)};
+}
+
+///
+/// \brief Whether any result is true. The emit stops at the first true result.
+///
+class any_of
+{
+public:
+  using result_type = bool;
+
+  bool operator()(bool result)
+  {
+    found = result;
+    return !found;
+  }
+
+  bool result() const
+  {
+    return found;
+  }
+
+private:
+  bool found = false;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // COMBINERS_HPP
@@ -0,0 +1,250 @@
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#include "memory_resource.hpp"
+#include "tags.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The part of a slot's state which a connection handle can see,
+/// independent of the signal parameters.
+///
+class connection_state
+{
+public:
+  virtual void reset() = 0;
+  virtual bool is_connected() const = 0;
+
+protected:
+  ~connection_state() = default;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A signal's state as its connections see it, so that a connection
+/// can tell the signals it's connected to when it's disconnected.
+///
+class connection_owner
+{
+public:
+  ///
+  /// \brief Called once some of the owner's connections have been
+  /// disconnected.
+  /// \param count The number of connections.
+  ///
+  virtual void disconnected(std::size_t count) const = 0;
+
+protected:
+  ~connection_owner() = default;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The state shared by the connections in a connection group. Each of
+/// them checks it along with its own state, so they can all be disconnected
+/// at once by a single store.
+///
+class group_state
+{
+public:
+  explicit group_state(memory_resource* memory = new_delete_resource())
+    : owners(owner_allocator_t{memory})
+  { }
+
+  group_state(const group_state&) = delete;
+  group_state& operator=(const group_state&) = delete;
+
+  bool is_connected() const
+  {
+    return connected.load(std::memory_order_relaxed);
+  }
+
+  ///
+  /// \brief Count an invocation of one of the group's functions, so that
+  /// reset() can wait for it. leave() must be called afterwards, whatever the
+  /// result.
+  /// \return Whether the group is still connected.
+  ///
+  bool enter()
+  {
+    in_flight.fetch_add(1, std::memory_order_seq_cst);
+    return connected.load(std::memory_order_seq_cst);
+  }
+
+  void leave()
+  {
+    in_flight.fetch_sub(1, std::memory_order_release);
+  }
+
+  ///
+  /// \brief Record a signal which one of the group's connections has been
+  /// connected to, so that reset() can tell it the connection is gone.
+  ///
+  void attach(const std::weak_ptr<const connection_owner>& owner)
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    for (auto& o : owners)
+    {
+      if (!o.owner.owner_before(owner) && !owner.owner_before(o.owner))
+      {
+        ++o.connections;
+        return;
+      }
+    }
+    owners.push_back(owner_count{owner, 1});
+  }
+
+  ///
+  /// \brief Disconnect every connection in the group, wait for any
+  /// invocations in other threads to finish, and then tell the signals, so
+  /// that they can drop the connections without waiting for an emit.
+  ///
+  void reset()
+  {
+    connected.store(false, std::memory_order_seq_cst);
+    while (in_flight.load(std::memory_order_acquire) != 0)
+      std::this_thread::yield();
+
+    owner_list_t notified{owners.get_allocator()};
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      notified.swap(owners);
+    }
+
+    for (const auto& o : notified)
+    {
+      if (auto owner = o.owner.lock())
+        owner->disconnected(o.connections);
+    }
+  }
+
+private:
+  struct owner_count
+  {
+    std::weak_ptr<const connection_owner> owner;
+    std::size_t connections;
+  };
+
+  using owner_allocator_t = resource_allocator<owner_count>;
+  using owner_list_t = std::vector<owner_count, owner_allocator_t>;
+
+  std::atomic<bool> connected{true};
+  std::atomic<unsigned> in_flight{0};
+  std::mutex mutex;
+  owner_list_t owners;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+template <class Policy, class... Params>
+class basic_signal;
+
+namespace detail {
+struct signal_access;
+}
+
+///
+/// \brief A handle to a function which has been connected directly to a
+/// signal, which can be used to disconnect it. Unlike a slot, the handle
+/// doesn't own the connection: destroying it leaves the function connected.
+///
+class connection
+{
+public:
+  ///
+  /// \brief Construct a handle which doesn't refer to any connection.
+  ///
+  connection() = default;
+
+  ///
+  /// \brief Disconnect the function and destroy it. Blocks until any
+  /// invocations in other threads have finished. Does nothing if the function
+  /// has already been disconnected.
+  /// \note It may be called from within the function itself, e.g. to
+  /// disconnect after the first emit. The function is then disconnected at
+  /// once, but only destroyed once the signal has released it.
+  ///
+  void disconnect();
+
+  ///
+  /// \brief Whether the function is still connected.
+  ///
+  bool connected() const;
+
+  ///
+  /// \brief Connect an existing signal to a function so that the function is
+  /// called when the signal is emitted.
+  /// \param signal A const reference to an existing signal to listen to.
+  /// \param fn A function to receive signals.
+  /// \return A handle with which to disconnect the function.
+  ///
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn);
+
+  ///
+  /// \brief Connect an existing signal to a function with a priority.
+  ///
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn,
+                            priority p);
+
+private:
+  friend struct detail::signal_access;
+
+  using weak_state_t = std::weak_ptr<detail::connection_state>;
+
+  explicit connection(weak_state_t);
+
+  weak_state_t state;
+};
+
+//------------------------------------------------------------------------------
+
+inline connection::connection(weak_state_t state)
+  : state{std::move(state)}
+{
+}
+
+inline void connection::disconnect()
+{
+  if (auto locked = state.lock())
+    locked->reset();
+  state.reset();
+}
+
+inline bool connection::connected() const
+{
+  auto locked = state.lock();
+  return locked && locked->is_connected();
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // CONNECTION_HPP
@@ -0,0 +1,229 @@
+#ifndef CONNECTION_GROUP_HPP
+#define CONNECTION_GROUP_HPP
+
+#include "connection.hpp"
+#include "signal.hpp"
+#include "slot.hpp"
+#include "tags.hpp"
+
+#include <memory>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A group of functions connected to any number of signals, which are
+/// all disconnected together when the group is disconnected or destroyed.
+///
+/// The connections in a group share a single state, so disconnecting the
+/// group is one store however many connections it has, rather than a lock
+/// per connection. The signals skip the group's connections from then on.
+/// Each signal is then told how many of its connections went, and compacts
+/// straight away if they make up enough of it, as it would if they had been
+/// disconnected one by one, which destroys their functions unless an emit
+/// on another thread is still visiting them. Otherwise the functions are
+/// destroyed the next time the signal compacts.
+///
+/// Slots can join a group too. A slot's connections to every signal are
+/// shared, so the whole slot is disconnected along with its group, and it
+/// can only join a group before it's first connected.
+///
+/// \code
+/// bb::connection_group group;
+/// bb::connect(signal, [](int value){ ... }, group);
+/// bb::connect(other_signal, [](){ ... }, group);
+/// group.disconnect();
+/// \endcode
+///
+class connection_group
+{
+public:
+  ///
+  /// \brief Construct an empty group.
+  ///
+  connection_group() = default;
+
+  ///
+  /// \brief Construct an empty group whose state is allocated from the given
+  /// memory resource, such as a bb::arena, rather than the heap.
+  /// \param resource The resource, which must outlive the group and every
+  /// connection in it.
+  ///
+  connection_group(std::allocator_arg_t, memory_resource& resource);
+
+  ///
+  /// \brief Deleted copy constructor.
+  ///
+  connection_group(const connection_group&) = delete;
+
+  ///
+  /// \brief Deleted copy assignment operator.
+  ///
+  connection_group& operator=(const connection_group&) = delete;
+
+  ///
+  /// \brief Move constructor. The other group is left empty.
+  ///
+  connection_group(connection_group&&) = default;
+
+  ///
+  /// \brief Move assignment operator. The group's existing connections are
+  /// disconnected first.
+  ///
+  connection_group& operator=(connection_group&&);
+
+  ///
+  /// \brief The destructor disconnects the group's connections.
+  ///
+  ~connection_group();
+
+  ///
+  /// \brief Disconnect every function in the group. Blocks until any
+  /// invocations in other threads have finished, so it mustn't be called from
+  /// one of the group's multi-threaded functions. The group is empty
+  /// afterwards, and may be used for new connections.
+  ///
+  void disconnect();
+
+  ///
+  /// \brief Connect an existing signal to a function in a group.
+  /// \param signal A const reference to an existing signal to listen to.
+  /// \param fn A function to receive signals.
+  /// \param group The group which the connection joins.
+  /// \return A handle with which to disconnect the function on its own.
+  ///
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn,
+                            connection_group& group);
+
+  ///
+  /// \brief Connect an existing signal to a function in a group, with a
+  /// priority.
+  ///
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn,
+                            priority p, connection_group& group);
+
+  ///
+  /// \brief Connect an existing signal to an existing slot, which joins the
+  /// group. The slot is disconnected from every signal when the group is
+  /// disconnected, and can't be connected again afterwards.
+  /// \param signal A const reference to an existing signal to listen to.
+  /// \param slot A reference to an existing slot to receive signals.
+  /// \param group The group which the slot joins. Does nothing if the slot is
+  /// already in another group, or has already been connected to a signal
+  /// outside this one.
+  ///
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot, connection_group& group);
+
+  ///
+  /// \brief Connect an existing signal to an existing slot, which joins the
+  /// group, with a priority.
+  ///
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot, priority p,
+                      connection_group& group);
+
+private:
+  memory_resource* memory = new_delete_resource();
+  std::shared_ptr<detail::group_state> state;
+};
+
+//------------------------------------------------------------------------------
+
+inline connection_group::connection_group(std::allocator_arg_t,
+                                          memory_resource& resource)
+  : memory(&resource)
+{
+}
+
+inline connection_group& connection_group::operator=(connection_group&& other)
+{
+  if (this != &other)
+  {
+    disconnect();
+    state = std::move(other.state);
+  }
+  return *this;
+}
+
+inline connection_group::~connection_group()
+{
+  disconnect();
+}
+
+inline void connection_group::disconnect()
+{
+  if (state)
+    state->reset();
+  state.reset();
+}
+
+template <class Fn, class Policy, class... Params>
+connection connect(const basic_signal<Policy, Params...>& signal, Fn fn,
+                   connection_group& group)
+{
+  return connect(signal, std::move(fn), priority{0}, group);
+}
+
+template <class Fn, class Policy, class... Params>
+connection connect(const basic_signal<Policy, Params...>& signal, Fn fn,
+                   priority p, connection_group& group)
+{
+  using function_t = typename basic_signal<Policy, Params...>::function_t;
+
+  auto& state = detail::signal_access::state(signal);
+  if (!state)
+    return connection{};
+
+  // The group's state is only allocated once something joins it.
+  if (!group.state)
+  {
+    group.state = std::allocate_shared<detail::group_state>(
+      resource_allocator<detail::group_state>{group.memory}, group.memory);
+  }
+
+  return detail::signal_access::make_connection(
+    state->connect(function_t{std::move(fn)}, p.value, group.state));
+}
+
+template <class Policy, class... Params>
+void connect(const basic_signal<Policy, Params...>& signal,
+             basic_slot<Policy, Params...>& slot, connection_group& group)
+{
+  connect(signal, slot, priority{0}, group);
+}
+
+template <class Policy, class... Params>
+void connect(const basic_signal<Policy, Params...>& signal,
+             basic_slot<Policy, Params...>& slot, priority p,
+             connection_group& group)
+{
+  auto& state = detail::signal_access::state(signal);
+  if (!state || !slot.state)
+    return;
+
+  if (!group.state)
+  {
+    group.state = std::allocate_shared<detail::group_state>(
+      resource_allocator<detail::group_state>{group.memory}, group.memory);
+  }
+
+  if (slot.state->join(group.state))
+    state->connect(slot.state, p.value);
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // CONNECTION_GROUP_HPP
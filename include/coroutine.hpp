@@ -0,0 +1,400 @@
+#ifndef COROUTINE_HPP
+#define COROUTINE_HPP
+
+#if __cplusplus < 202002L
+#error "coroutine.hpp requires C++20; the rest of bb-signals only needs C++14"
+#endif
+
+#include "memory_resource.hpp"
+#include "signal.hpp"
+#include "tags.hpp"
+#include "detail/slot_state.hpp"
+#include "detail/threading.hpp"
+
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The result of awaiting a signal: nothing for a signal without
+/// parameters, the argument for a signal with one, and otherwise a tuple of
+/// the arguments.
+///
+template <class... Params>
+struct awaited
+{
+  using event_t = std::tuple<std::decay_t<Params>...>;
+  using type = event_t;
+
+  static type take(event_t&& event)
+  {
+    return std::move(event);
+  }
+};
+
+template <>
+struct awaited<>
+{
+  using event_t = std::tuple<>;
+  using type = void;
+
+  static void take(event_t&&)
+  { }
+};
+
+template <class Param>
+struct awaited<Param>
+{
+  using event_t = std::tuple<std::decay_t<Param>>;
+  using type = std::decay_t<Param>;
+
+  static type take(event_t&& event)
+  {
+    return std::get<0>(std::move(event));
+  }
+};
+
+///
+/// \brief A reentrant slot which hands emissions to an awaiting coroutine,
+/// resuming it on the emitting thread, or buffers them until a coroutine
+/// awaits.
+///
+/// The slot's function shares ownership of the channel, so closing the
+/// channel never has to wait for an emit in progress, and a coroutine may
+/// close it from within its own resumption.
+///
+template <class Policy, class... Params>
+class emission_channel
+{
+public:
+  using event_t = typename awaited<Params...>::event_t;
+
+  ///
+  /// \brief Connect a new channel to the signal. A one-shot channel is
+  /// disconnected by the first emission it receives. The channel and its
+  /// connection are allocated from the signal's memory resource, like the
+  /// signal's other connections.
+  ///
+  static std::shared_ptr<emission_channel>
+  open(const basic_signal<Policy, Params...>& signal, bool one_shot)
+  {
+    auto& signal_state = signal_access::state(signal);
+    memory_resource* memory =
+      signal_state ? signal_state->resource() : new_delete_resource();
+
+    auto channel = std::allocate_shared<emission_channel>(
+      resource_allocator<emission_channel>{memory}, memory, one_shot);
+    if (!signal_state)
+      return channel;
+
+    auto slot = std::allocate_shared<slot_state_t>(
+      resource_allocator<slot_state_t>{memory}, memory, reentrant,
+      function_t{[channel](auto&&... args)
+      {
+        channel->deliver(event_t{std::forward<decltype(args)>(args)...});
+      }});
+
+    channel->slot = slot;
+    signal_state->connect(std::move(slot));
+    return channel;
+  }
+
+  emission_channel(memory_resource* memory, bool one_shot)
+    : events(resource_allocator<event_t>{memory})
+    , one_shot(one_shot)
+  { }
+
+  ///
+  /// \brief Take a buffered event if there is one, and otherwise register the
+  /// coroutine to receive the next event in result.
+  /// \return Whether the coroutine should stay suspended.
+  ///
+  bool suspend(std::coroutine_handle<> handle, std::optional<event_t>& result)
+  {
+    std::unique_lock<mutex_t> lock{mutex};
+    if (!events.empty())
+    {
+      result.emplace(std::move(events.front()));
+      events.pop_front();
+      return false;
+    }
+
+    waiter = handle;
+    waiting_result = &result;
+    return true;
+  }
+
+  ///
+  /// \brief Forget the coroutine waiting to receive an event in result, if
+  /// there still is one, because it's being destroyed.
+  ///
+  void cancel(const std::optional<event_t>& result)
+  {
+    std::unique_lock<mutex_t> lock{mutex};
+    if (waiting_result == &result)
+    {
+      waiter = nullptr;
+      waiting_result = nullptr;
+    }
+  }
+
+  ///
+  /// \brief Disconnect from the signal, and forget any awaiting coroutine.
+  ///
+  void close()
+  {
+    std::unique_lock<mutex_t> lock{mutex};
+    closed = true;
+    waiter = nullptr;
+    waiting_result = nullptr;
+    events.clear();
+    disconnect();
+  }
+
+private:
+  using slot_state_t = slot_state<Policy, Params...>;
+  using function_t = typename slot_state_t::function_t;
+  using mutex_t = typename threading<Policy>::mutex_t;
+
+  void deliver(event_t event)
+  {
+    std::unique_lock<mutex_t> lock{mutex};
+    if (closed)
+      return;
+
+    if (one_shot)
+    {
+      closed = true;
+      disconnect();
+    }
+
+    if (!waiter)
+    {
+      events.push_back(std::move(event));
+      return;
+    }
+
+    auto handle = std::exchange(waiter, nullptr);
+    std::exchange(waiting_result, nullptr)->emplace(std::move(event));
+    lock.unlock();
+
+    handle.resume();
+  }
+
+  // Must be called with the mutex held.
+  void disconnect()
+  {
+    if (auto locked = slot.lock())
+      locked->disconnect();
+  }
+
+  mutex_t mutex;
+  std::weak_ptr<slot_state_t> slot;
+  std::deque<event_t, resource_allocator<event_t>> events;
+  std::coroutine_handle<> waiter;
+  std::optional<event_t>* waiting_result = nullptr;
+  const bool one_shot;
+  bool closed = false;
+};
+
+///
+/// \brief Awaits the next event from a channel, or waits forever if there
+/// isn't one, as for a signal which is never emitted.
+///
+template <class Policy, class... Params>
+class emission_awaiter
+{
+public:
+  using channel_t = emission_channel<Policy, Params...>;
+
+  explicit emission_awaiter(channel_t* channel)
+    : channel(channel)
+  { }
+
+  emission_awaiter(const emission_awaiter&) = delete;
+  emission_awaiter& operator=(const emission_awaiter&) = delete;
+
+  ///
+  /// \brief Stop waiting, if the coroutine is destroyed while it's suspended,
+  /// so that the next emission doesn't resume it.
+  ///
+  ~emission_awaiter()
+  {
+    if (channel)
+      channel->cancel(result);
+  }
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  bool await_suspend(std::coroutine_handle<> handle)
+  {
+    return !channel || channel->suspend(handle, result);
+  }
+
+  typename awaited<Params...>::type await_resume()
+  {
+    return awaited<Params...>::take(std::move(*result));
+  }
+
+private:
+  channel_t* channel;
+  std::optional<typename channel_t::event_t> result;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief An awaitable which resumes the awaiting coroutine with the arguments
+/// of the signal's next emission. Returned by next().
+///
+/// The coroutine is resumed on the emitting thread, from within the emit. The
+/// awaitable connects to the signal when it's created, and disconnects after
+/// one emission or when it's destroyed.
+///
+template <class Policy, class... Params>
+class next_awaitable
+{
+public:
+  explicit next_awaitable(const basic_signal<Policy, Params...>& signal)
+    : channel(channel_t::open(signal, true))
+    , awaiter(channel.get())
+  { }
+
+  next_awaitable(const next_awaitable&) = delete;
+  next_awaitable& operator=(const next_awaitable&) = delete;
+
+  ~next_awaitable()
+  {
+    channel->close();
+  }
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  bool await_suspend(std::coroutine_handle<> handle)
+  {
+    return awaiter.await_suspend(handle);
+  }
+
+  auto await_resume()
+  {
+    return awaiter.await_resume();
+  }
+
+private:
+  using channel_t = detail::emission_channel<Policy, Params...>;
+
+  std::shared_ptr<channel_t> channel;
+  detail::emission_awaiter<Policy, Params...> awaiter;
+};
+
+///
+/// \brief Await the next emission of a signal.
+/// \code
+/// int value = co_await bb::next(signal);
+/// \endcode
+/// A signal without parameters produces void, a signal with one parameter
+/// produces its argument, and otherwise the result is a tuple of the
+/// arguments. Awaiting a signal which is never emitted never resumes.
+///
+template <class Policy, class... Params>
+next_awaitable<Policy, Params...>
+next(const basic_signal<Policy, Params...>& signal)
+{
+  return next_awaitable<Policy, Params...>{signal};
+}
+
+///
+/// \brief An asynchronous stream of a signal's emissions, which stays
+/// connected between awaits so that no emission is missed. Returned by
+/// emissions().
+///
+/// Emissions received while no coroutine is awaiting are buffered. A
+/// coroutine awaiting next() is resumed on the emitting thread, from within
+/// the emit. Only one coroutine may await a stream at a time.
+///
+template <class Policy, class... Params>
+class emission_stream
+{
+public:
+  explicit emission_stream(const basic_signal<Policy, Params...>& signal)
+    : channel(channel_t::open(signal, false))
+  { }
+
+  emission_stream(const emission_stream&) = delete;
+  emission_stream& operator=(const emission_stream&) = delete;
+  emission_stream(emission_stream&&) = default;
+  emission_stream& operator=(emission_stream&&) = default;
+
+  ///
+  /// \brief Disconnect from the signal and drop any buffered emissions.
+  ///
+  ~emission_stream()
+  {
+    if (channel)
+      channel->close();
+  }
+
+  ///
+  /// \brief Await the next emission, which produces the same result as
+  /// bb::next().
+  /// \note A stream which has been moved from is disconnected, so awaiting
+  /// it never resumes, as for a signal which is never emitted.
+  ///
+  detail::emission_awaiter<Policy, Params...> next()
+  {
+    return detail::emission_awaiter<Policy, Params...>{channel.get()};
+  }
+
+private:
+  using channel_t = detail::emission_channel<Policy, Params...>;
+
+  std::shared_ptr<channel_t> channel;
+};
+
+///
+/// \brief Open a stream of a signal's emissions.
+/// \code
+/// auto stream = bb::emissions(signal);
+/// while (true)
+///   handle(co_await stream.next());
+/// \endcode
+///
+template <class Policy, class... Params>
+emission_stream<Policy, Params...>
+emissions(const basic_signal<Policy, Params...>& signal)
+{
+  return emission_stream<Policy, Params...>{signal};
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // COROUTINE_HPP
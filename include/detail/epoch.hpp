@@ -0,0 +1,153 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A minimal epoch-based reclamation domain, of which each signal has
+/// its own.
+///
+/// Readers pin the current epoch for the duration of a read-side critical
+/// section; writers retire unlinked objects tagged with the epoch at which
+/// they were retired. An object retired at epoch e may be destroyed once the
+/// epoch has reached e + 2, at which point no reader can still hold a
+/// reference to it.
+///
+/// Readers are counted by the parity of the epoch they pinned, in counters
+/// which are sharded between threads, so readers on different threads rarely
+/// touch the same cache line. The epoch only advances once nothing is pinning
+/// the previous one, so a reader which blocks holds back reclamation in its
+/// own domain, but not in any other.
+///
+class epoch_domain
+{
+public:
+  using epoch_t = std::uint64_t;
+
+  ///
+  /// \brief RAII guard which pins the domain's current epoch.
+  ///
+  class guard
+  {
+  public:
+    explicit guard(epoch_domain& domain)
+      : readers(domain.pin())
+    { }
+
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+    ~guard()
+    {
+      readers.fetch_sub(1, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<std::size_t>& readers;
+  };
+
+  epoch_domain() = default;
+  epoch_domain(const epoch_domain&) = delete;
+  epoch_domain& operator=(const epoch_domain&) = delete;
+
+  ///
+  /// \brief The epoch with which an object unlinked by the caller should be
+  /// retired.
+  ///
+  epoch_t retire_epoch()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return current.load(std::memory_order_acquire);
+  }
+
+  ///
+  /// \brief Try to advance the epoch.
+  /// \return The epoch after the attempt.
+  ///
+  epoch_t advance()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    epoch_t epoch = current.load(std::memory_order_acquire);
+
+    // Readers of the current epoch don't stop it advancing, but readers of
+    // the previous one, which share a parity with the next, do.
+    std::size_t previous = (epoch + 1) & 1;
+    for (const shard& s : shards)
+    {
+      if (s.readers[previous].load(std::memory_order_acquire) != 0)
+        return epoch;
+    }
+
+    if (current.compare_exchange_strong(epoch, epoch + 1,
+                                        std::memory_order_acq_rel))
+      return epoch + 1;
+    return epoch;
+  }
+
+  ///
+  /// \brief Whether an object retired at the given epoch can be destroyed.
+  ///
+  static bool is_safe(epoch_t retired, epoch_t current)
+  {
+    return current >= retired + 2;
+  }
+
+private:
+  static constexpr std::size_t shard_count = 8;
+
+  struct shard
+  {
+    std::atomic<std::size_t> readers[2] = {};
+
+    // Keep each shard's counters off its neighbours' cache lines.
+    char padding[64];
+  };
+
+  static std::size_t shard_index()
+  {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t index =
+      next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+    return index;
+  }
+
+  std::atomic<std::size_t>& pin()
+  {
+    // A reader which loads an epoch just before it advances still counts
+    // itself before it loads any protected pointers. The increment orders
+    // the count before those loads, like a store followed by a full fence, so
+    // the reader can only see objects which haven't been retired yet, and
+    // its count holds back the epoch before they can become safe.
+    epoch_t epoch = current.load(std::memory_order_acquire);
+    auto& readers = shards[shard_index()].readers[epoch & 1];
+    readers.fetch_add(1, std::memory_order_seq_cst);
+    return readers;
+  }
+
+  std::atomic<epoch_t> current{1};
+  shard shards[shard_count];
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // EPOCH_HPP
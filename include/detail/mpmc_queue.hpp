@@ -0,0 +1,219 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include "../memory_resource.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A bounded, lock-free, multi-producer multi-consumer queue.
+///
+/// This is Dmitry Vyukov's array-based queue: each cell carries a sequence
+/// number which tells producers and consumers whether it's ready for them,
+/// so the only contention is a single compare-and-swap on the enqueue or
+/// dequeue position. The array's size is a power of two, of at least two
+/// cells, and a capacity which is smaller is enforced separately.
+///
+template <class T>
+class mpmc_queue
+{
+public:
+  ///
+  /// \brief Construct a queue.
+  /// \param capacity The maximum number of elements, which is at least one.
+  /// \param memory The resource to allocate the cells from.
+  ///
+  explicit mpmc_queue(std::size_t capacity,
+                      memory_resource* memory = new_delete_resource())
+    : limit(std::max<std::size_t>(capacity, 1))
+    , mask(round_up(limit) - 1)
+    , memory(memory)
+    , cells(static_cast<cell*>(
+        memory->allocate(sizeof(cell) * (mask + 1), alignof(cell))))
+  {
+    for (std::size_t i = 0; i <= mask; ++i)
+    {
+      ::new (static_cast<void*>(&cells[i])) cell;
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpmc_queue(const mpmc_queue&) = delete;
+  mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+  ~mpmc_queue()
+  {
+    std::size_t position = dequeue_position.load(std::memory_order_relaxed);
+    std::size_t end = enqueue_position.load(std::memory_order_relaxed);
+    for (; position != end; ++position)
+      reinterpret_cast<T*>(&cells[position & mask].storage)->~T();
+
+    // The cells themselves are trivially destructible.
+    memory->deallocate(cells, sizeof(cell) * (mask + 1), alignof(cell));
+  }
+
+  ///
+  /// \brief Push an element, unless the queue is full.
+  /// \return Whether the element was pushed. If not, value is unchanged.
+  ///
+  template <class U>
+  bool try_push(U&& value)
+  {
+    std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+      cell& c = cells[position & mask];
+      std::size_t sequence = c.sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+      if (difference == 0)
+      {
+        // Consumers only ever advance, so if the queue is below its capacity
+        // at this position, it still is if the position is claimed.
+        if (limit != mask + 1 &&
+            position - dequeue_position.load(std::memory_order_acquire) >=
+              limit)
+          return false;
+
+        if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          ::new (static_cast<void*>(&c.storage)) T(std::forward<U>(value));
+          c.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        position = enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  ///
+  /// \brief Pop the oldest element, unless the queue is empty.
+  /// \return Whether an element was popped into value.
+  ///
+  bool try_pop(T& value)
+  {
+    return try_consume([&value](T&& element){ value = std::move(element); });
+  }
+
+  ///
+  /// \brief Pop the oldest element, unless the queue is empty, and pass it to
+  /// consume. The element's cell is released before consume is called.
+  /// \return Whether an element was popped.
+  ///
+  template <class Consume>
+  bool try_consume(Consume&& consume)
+  {
+    std::size_t position = dequeue_position.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+      cell& c = cells[position & mask];
+      std::size_t sequence = c.sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+      if (difference == 0)
+      {
+        if (dequeue_position.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          T* stored = reinterpret_cast<T*>(&c.storage);
+          T element(std::move(*stored));
+          stored->~T();
+          c.sequence.store(position + mask + 1, std::memory_order_release);
+          consume(std::move(element));
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false;
+      }
+      else
+      {
+        position = dequeue_position.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  ///
+  /// \brief The maximum number of elements.
+  ///
+  std::size_t capacity() const
+  {
+    return limit;
+  }
+
+  ///
+  /// \brief Whether the queue appeared to be empty.
+  ///
+  bool empty() const
+  {
+    std::size_t position = dequeue_position.load(std::memory_order_seq_cst);
+    const cell& c = cells[position & mask];
+    return c.sequence.load(std::memory_order_seq_cst) != position + 1;
+  }
+
+private:
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  static std::size_t round_up(std::size_t capacity)
+  {
+    std::size_t result = 2;
+    while (result < capacity)
+      result *= 2;
+    return result;
+  }
+
+  const std::size_t limit;
+  const std::size_t mask;
+  memory_resource* const memory;
+  cell* const cells;
+
+  // Keep the positions on separate cache lines, since producers write one
+  // and consumers the other.
+  char padding[64];
+  std::atomic<std::size_t> enqueue_position{0};
+  char enqueue_padding[64];
+  std::atomic<std::size_t> dequeue_position{0};
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // MPMC_QUEUE_HPP
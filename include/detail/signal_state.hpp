@@ -1,13 +1,21 @@
 #ifndef SIGNAL_STATE_HPP
 #define SIGNAL_STATE_HPP
 
+#include "../memory_resource.hpp"
 #include "slot_state.hpp"
+#include "threading.hpp"
 
-#include <functional>
-#include <list>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -19,94 +27,642 @@ namespace detail {
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-class signal_state
+template <bool... Values>
+struct all_of
+  : std::is_same<all_of<Values...>, all_of<(Values || true)...>>
+{ };
+
+//------------------------------------------------------------------------------
+
+// The number of signal write sections which the calling thread is in. A
+// connection can be disconnected during one, e.g. by a function which is
+// destroyed when its tombstone is reclaimed, and then its signal doesn't try
+// to compact again from within itself.
+inline unsigned& write_depth()
+{
+  thread_local unsigned depth = 0;
+  return depth;
+}
+
+//------------------------------------------------------------------------------
+
+template <class Policy, class... Params>
+class signal_state final
+  : public connection_owner
+  , public std::enable_shared_from_this<signal_state<Policy, Params...>>
 {
 public:
-  using slot_state_t = slot_state<Params...>;
+  using slot_state_t = slot_state<Policy, Params...>;
   using connection_t = std::shared_ptr<slot_state_t>;
-  using weak_connection_t = std::weak_ptr<slot_state_t>;
-  using function_t = std::function<void(Params...)>;
+  using function_t = inplace_function<void(Params...)>;
+  using handler_function_t = typename slot_state_t::handler_function_t;
+  using event_t = typename slot_state_t::event_t;
+  using shared_event_t = typename slot_state_t::shared_event_t;
+
+  ///
+  /// \brief Construct a state whose slot tables, function connections and
+  /// bookkeeping are allocated from the given resource, which must outlive
+  /// it.
+  ///
+  explicit signal_state(memory_resource* memory = new_delete_resource())
+    : memory(memory)
+    , owners(memory)
+    , retired(memory)
+  { }
 
-  signal_state() = default;
   signal_state(const signal_state&) = delete;
   signal_state& operator=(const signal_state&) = delete;
   signal_state(signal_state&&) = delete;
   signal_state& operator=(signal_state&&) = delete;
 
-  void connect(weak_connection_t connection) const
+  ~signal_state()
   {
-    std::unique_lock<std::mutex> lock{new_connections_mutex};
-    new_connections.push_back(std::move(connection));
+    // Nothing can be emitting any more, so the current and retired tables
+    // can be destroyed immediately.
+    if (auto slots = table.load(std::memory_order_relaxed))
+      table_deleter{memory}(slots);
   }
 
-  void connect(function_t fn) const
+  void connect(connection_t connection, int priority = 0) const
   {
-    auto connection = std::make_shared<slot_state_t>(std::move(fn));
-    connect(weak_connection_t{connection});
+    // The table has to be copied anyway, so any tombstones are dropped from
+    // the copy at the same time.
+    std::unique_lock<mutex_t> lock{write_mutex, std::defer_lock};
+    stats.lock(lock);
+    write_scope scope;
+    connection->attach(this->shared_from_this());
+    rebuild(owner{std::move(connection), priority});
+  }
 
-    std::unique_lock<std::mutex> lock{persistent_connections_mutex};
-    persistent_connections.emplace_back(std::move(connection));
+  connection_t connect(function_t fn, int priority = 0) const
+  {
+    // The table owns its connections, so a function connection lives until
+    // it's disconnected through the returned state, or the signal is
+    // destroyed.
+    auto connection = std::allocate_shared<slot_state_t>(
+      resource_allocator<slot_state_t>{memory}, memory, std::move(fn));
+    connect(connection, priority);
+    return connection;
+  }
+
+  connection_t connect(function_t fn, int priority,
+                       std::shared_ptr<group_state> group) const
+  {
+    // The group is set before the state is published, so emits never see it
+    // change.
+    auto connection = std::allocate_shared<slot_state_t>(
+      resource_allocator<slot_state_t>{memory}, memory, std::move(fn));
+    connection->join(group);
+    connect(connection, priority);
+    return connection;
+  }
+
+  connection_t connect(handler_function_t fn, int priority) const
+  {
+    auto connection = std::allocate_shared<slot_state_t>(
+      resource_allocator<slot_state_t>{memory}, memory, short_circuit,
+      std::move(fn));
+    connect(connection, priority);
+    return connection;
+  }
+
+  ///
+  /// \brief The resource which the state and its connections are allocated
+  /// from.
+  ///
+  memory_resource* resource() const
+  {
+    return memory;
+  }
+
+  void set_metrics_name(std::string name)
+  {
+    stats.set_name(std::move(name));
+  }
+
+  ///
+  /// \brief Stop emitting and release the connections, once the signal has
+  /// gone. Pinned emitters may keep the state itself alive for longer.
+  ///
+  void close()
+  {
+    open.store(false, std::memory_order_relaxed);
+
+    std::unique_lock<mutex_t> lock{write_mutex, std::defer_lock};
+    stats.lock(lock);
+    write_scope scope;
+    owner_list_t removed{memory};
+    removed.swap(owners);
+    stats.reaped(removed.size());
+    publish(table_ptr{nullptr, table_deleter{memory}}, std::move(removed));
+
+    // Nothing will publish again, so advance once more to release the
+    // connections now if no emit is visiting them.
+    reclaim(reclaimer.advance());
+  }
+
+  ///
+  /// \brief Count connections which have been disconnected, and compact once
+  /// enough of the table is tombstones, as an emit would, so that a signal
+  /// which isn't emitted again doesn't keep them forever.
+  ///
+  void disconnected(std::size_t count) const override
+  {
+    std::size_t dead =
+      disconnects.fetch_add(count, std::memory_order_relaxed) + count;
+    std::size_t size = published_size.load(std::memory_order_relaxed);
+    if (write_depth() == 0 && is_open() && dead * compaction_ratio >= size)
+      compact();
+  }
+
+  ///
+  /// \brief Whether the signal is still alive.
+  ///
+  bool is_open() const
+  {
+    return open.load(std::memory_order_relaxed);
   }
 
   template <class... Args>
   void emit(Args&&... args) const
   {
-    std::unique_lock<std::mutex> lock(connections_mutex);
+    static_assert(can_share_arguments::value,
+                  "emit() requires parameters which can be initialized from "
+                  "an lvalue, so that every slot receives the arguments");
+
+    visit([&](const slot_table_t& slots)
+    {
+      return fan_out(slots, std::true_type{}, std::forward<Args>(args)...);
+    });
+  }
+
+  template <class... Args>
+  void emit_to_last(Args&&... args) const
+  {
+    visit([&](const slot_table_t& slots)
+    {
+      return fan_out(slots, std::false_type{}, std::forward<Args>(args)...);
+    });
+  }
+
+  template <class... Args>
+  void emit_shared(Args&&... args) const
+  {
+    static_assert(can_share_event::value,
+                  "emit_shared() requires parameters which can be "
+                  "initialized from a const lvalue");
+
+    // The event is only materialized once a connected slot is found, and
+    // then only once for all of them.
+    shared_event_t event;
+
+    visit([&](const slot_table_t& slots)
+    {
+      std::size_t tombstones = 0;
+
+      for (const slot_state_t* slot : slots)
+      {
+        if (!slot->is_connected())
+        {
+          ++tombstones;
+          continue;
+        }
+
+        if (!event)
+          event = std::make_shared<const event_t>(std::forward<Args>(args)...);
+        if (slot->post_shared(event))
+          break;
+      }
+
+      return tombstones;
+    });
+  }
+
+  template <class Executor, class... Args>
+  void emit_parallel(Executor& executor, Args&&... args) const
+  {
+    static_assert(threading_t::concurrent,
+                  "emit_parallel() requires the multi_threaded policy");
+    static_assert(can_share_event::value,
+                  "emit_parallel() requires parameters which can be "
+                  "initialized from a const lvalue");
+
+    visit([&](const slot_table_t& slots)
+    {
+      return fork_join(executor, slots, std::forward<Args>(args)...);
+    });
+  }
+
+  template <class Range>
+  void emit_batch(const Range& events) const
+  {
+    batch_source<Range, Params...> source{events};
+
+    visit([&](const slot_table_t& slots)
+    {
+      std::size_t tombstones = 0;
+
+      for (const slot_state_t* slot : slots)
+      {
+        if (slot->is_connected())
+          slot->post_batch(source);
+        else
+          ++tombstones;
+      }
+
+      return tombstones;
+    });
+  }
+
+private:
+  using threading_t = threading<Policy>;
+  using mutex_t = typename threading_t::mutex_t;
+  using reclaimer_t = typename threading_t::reclaimer_t;
+  using epoch_t = typename reclaimer_t::epoch_t;
+
+  template <class T>
+  using atomic_t = typename threading_t::template atomic_t<T>;
+
+  // A dense table of the connected slot states, in priority order and then
+  // connection order. Entries are borrowed from the owners list, and
+  // disconnected entries remain as tombstones until the table is compacted.
+  using slot_table_t = std::vector<const slot_state_t*,
+    resource_allocator<const slot_state_t*>>;
+  using table_deleter = resource_deleter<const slot_table_t>;
+  using table_ptr = std::unique_ptr<const slot_table_t, table_deleter>;
+
+  struct owner
+  {
+    connection_t connection;
+    int priority;
+  };
+
+  using owner_list_t = std::vector<owner, resource_allocator<owner>>;
+
+  struct retired_table
+  {
+    epoch_t epoch;
+    table_ptr slots;
+    owner_list_t owners;
+  };
+
+  // The table is compacted by an emit once at least 1 / compaction_ratio of
+  // its entries are tombstones, so that the cost of rebuilding it is spread
+  // over many disconnections.
+  static constexpr std::size_t compaction_ratio = 4;
+
+  // Pin the current table and pass it to visitor, which returns the number of
+  // tombstones it found. The table is immutable once published, so visiting
+  // it never blocks connect() or other emitters. The table owns its slot
+  // states, so they can be visited without touching their reference counts.
+  // The scope is declared first, so that if a slot lets go of the state's
+  // last owner, the state is destroyed after everything else here.
+  template <class Visitor>
+  void visit(Visitor&& visitor) const
+  {
+    visit_scope scope{this};
+
+    std::size_t tombstones = 0;
+    std::size_t size = 0;
+
+    {
+      typename reclaimer_t::guard guard{reclaimer};
+      const slot_table_t* slots = table.load(std::memory_order_acquire);
+
+      if (slots)
+      {
+        tombstones = visitor(*slots);
+        size = slots->size();
+      }
+    }
 
-    splice_new_connections(connections);
+    stats.emitted(size);
 
-    if (connections.size() == 1)
+    if (tombstones != 0 && tombstones * compaction_ratio >= size)
+      compact();
+  }
+
+  // The work shared by the threads of a parallel emit. The emitting thread
+  // waits for every chunk which is claimed to finish, but closures which find
+  // that there are no chunks left may run after it has returned, so they
+  // share ownership of the job and never touch the table.
+  struct parallel_job
+  {
+    template <class... Args>
+    parallel_job(const slot_table_t& slots, std::size_t chunk_size,
+                 Args&&... args)
+      : slots(&slots)
+      , chunk_size(chunk_size)
+      , chunks((slots.size() + chunk_size - 1) / chunk_size)
+      , event(std::forward<Args>(args)...)
+    { }
+
+    // Claim and run chunks until there are none left. Once a slot has thrown,
+    // the remaining chunks are claimed but not run, and the first exception is
+    // kept for the emitting thread to rethrow.
+    void run(const shared_event_t& shared_event) noexcept
     {
-      // If there's only a single connection then we can forward the arguments
-      // directly to it without copying.
-      try_post(connections.begin(), std::forward<Args>(args)...);
+      std::size_t chunk;
+      while ((chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunks)
+      {
+        if (!failed.load(std::memory_order_relaxed))
+        {
+          try
+          {
+            run_chunk(chunk, shared_event);
+          }
+          catch (...)
+          {
+            if (!failed.exchange(true, std::memory_order_relaxed))
+              error = std::current_exception();
+          }
+        }
+
+        finished.fetch_add(1, std::memory_order_release);
+      }
     }
-    else
+
+    void run_chunk(std::size_t chunk, const shared_event_t& shared_event)
     {
-      auto it = connections.begin();
-      auto end = connections.end();
+      std::size_t first = chunk * chunk_size;
+      std::size_t last = std::min(first + chunk_size, slots->size());
 
-      while (it != end)
+      std::size_t dead = 0;
+      for (std::size_t i = first; i != last; ++i)
       {
-        it = try_post(it, args...);
+        const slot_state_t* slot = (*slots)[i];
+        if (slot->is_connected())
+          slot->post_shared(shared_event);
+        else
+          ++dead;
       }
+
+      tombstones.fetch_add(dead, std::memory_order_relaxed);
+    }
+
+    const slot_table_t* slots;
+    const std::size_t chunk_size;
+    const std::size_t chunks;
+    const event_t event;
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> finished{0};
+    std::atomic<std::size_t> tombstones{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+  };
+
+  // Each thread of a parallel emit takes several chunks on average, so that
+  // uneven slots balance out.
+  static constexpr std::size_t chunks_per_thread = 4;
+
+  // The number of threads which an executor can run closures on, if it says,
+  // as thread_pool_executor does.
+  template <class Executor, class = void>
+  struct executor_width
+  {
+    static std::size_t get(const Executor&)
+    {
+      return std::max(std::thread::hardware_concurrency(), 1u);
     }
+  };
+
+  template <class Executor>
+  struct executor_width<Executor,
+    void_t<decltype(std::declval<const Executor&>().size())>>
+  {
+    static std::size_t get(const Executor& executor)
+    {
+      return std::max<std::size_t>(executor.size(), 1);
+    }
+  };
+
+  // Split the table into chunks, which are claimed by the calling thread and
+  // by closures submitted to the executor, and wait for them all to finish.
+  // The table is only protected until this returns, so it waits even if a
+  // slot throws, and then rethrows the exception.
+  template <class Executor, class... Args>
+  static std::size_t fork_join(Executor& executor, const slot_table_t& slots,
+                               Args&&... args)
+  {
+    if (slots.empty())
+      return 0;
+
+    // The calling thread takes part as well as each of the executor's.
+    std::size_t threads = executor_width<Executor>::get(executor) + 1;
+    std::size_t chunk_size = std::max<std::size_t>(
+      slots.size() / (threads * chunks_per_thread), 1);
+
+    auto job = std::make_shared<parallel_job>(slots, chunk_size,
+                                              std::forward<Args>(args)...);
+    shared_event_t shared_event{job, &job->event};
+
+    std::size_t helpers = std::min(threads, job->chunks) - 1;
+    for (std::size_t i = 0; i < helpers; ++i)
+    {
+      executor.submit([job, shared_event]
+      {
+        job->run(shared_event);
+      });
+    }
+
+    job->run(shared_event);
+    while (job->finished.load(std::memory_order_acquire) != job->chunks)
+      std::this_thread::yield();
+
+    if (job->error)
+      std::rethrow_exception(job->error);
+
+    return job->tombstones.load(std::memory_order_relaxed);
   }
 
-private:
-  using connection_list_t = std::list<weak_connection_t>;
-  using persistent_connection_list_t = std::list<connection_t>;
+  // Whether the arguments can be passed to more than one slot, i.e. whether
+  // every parameter can be initialized from an lvalue.
+  using can_share_arguments = std::integral_constant<bool,
+    all_of<std::is_constructible<
+      Params, typename std::decay<Params>::type&>::value...>::value>;
 
+  // Whether every parameter can be initialized from an immutable event.
+  using can_share_event = std::integral_constant<bool,
+    all_of<std::is_constructible<
+      Params, const typename std::decay<Params>::type&>::value...>::value>;
+
+  // Deliver the arguments to every connected slot, until one handles them.
+  // Every slot but the last receives them as lvalues, and they are forwarded
+  // to the last one, so rvalue arguments are moved into it rather than
+  // copied.
   template <class... Args>
-  typename connection_list_t::iterator
-  try_post(typename connection_list_t::iterator it, Args&&... args) const
+  static std::size_t fan_out(const slot_table_t& slots, std::true_type,
+                             Args&&... args)
   {
-    if (auto connection = it->lock())
+    auto last = find_last_connected(slots);
+    if (last == slots.end())
+      return slots.size();
+
+    auto tombstones = static_cast<std::size_t>(slots.end() - (last + 1));
+
+    for (auto it = slots.begin(); it != last; ++it)
     {
-      connection->post(std::forward<Args>(args)...);
-      return ++it;
+      if (!(*it)->is_connected())
+        ++tombstones;
+      else if ((*it)->post(args...))
+        return tombstones;
     }
-    else
+
+    if (!try_post(**last, std::forward<Args>(args)...))
+      ++tombstones;
+
+    return tombstones;
+  }
+
+  // Deliver the arguments to the last connected slot only, moving them into
+  // it, for arguments which are move-only.
+  template <class... Args>
+  static std::size_t fan_out(const slot_table_t& slots, std::false_type,
+                             Args&&... args)
+  {
+    auto last = find_last_connected(slots);
+    if (last == slots.end())
+      return slots.size();
+
+    auto tombstones = static_cast<std::size_t>(
+      std::count_if(slots.begin(), last,
+        [](const slot_state_t* slot) { return !slot->is_connected(); }) +
+      (slots.end() - (last + 1)));
+
+    if (!try_post(**last, std::forward<Args>(args)...))
+      ++tombstones;
+
+    return tombstones;
+  }
+
+  static typename slot_table_t::const_iterator
+  find_last_connected(const slot_table_t& slots)
+  {
+    auto it = slots.end();
+    while (it != slots.begin())
     {
-      return connections.erase(it);
+      --it;
+      if ((*it)->is_connected())
+        return it;
     }
+    return slots.end();
   }
 
-  void splice_new_connections(connection_list_t& list) const
+  template <class... Args>
+  static bool try_post(const slot_state_t& slot, Args&&... args)
   {
-    std::unique_lock<std::mutex> lock(new_connections_mutex);
-    list.splice(list.end(), new_connections);
+    if (!slot.is_connected())
+      return false;
+
+    slot.post(std::forward<Args>(args)...);
+    return true;
+  }
+
+  // Must be called with write_mutex held. Any owners which have been removed
+  // from the table are kept alive until no emit can still be visiting them.
+  void publish(table_ptr next, owner_list_t removed) const
+  {
+    const slot_table_t* previous =
+      table.exchange(next.release(), std::memory_order_acq_rel);
+
+    if (previous)
+      retired.push_back({reclaimer.retire_epoch(),
+                         table_ptr{previous, table_deleter{memory}},
+                         std::move(removed)});
+
+    reclaim(reclaimer.advance());
   }
 
-  mutable std::mutex new_connections_mutex;
-  mutable connection_list_t new_connections;
+  // Must be called with write_mutex held.
+  void reclaim(epoch_t epoch) const
+  {
+    auto it = retired.begin();
+    while (it != retired.end() && reclaimer_t::is_safe(it->epoch, epoch))
+      ++it;
+    retired.erase(retired.begin(), it);
+  }
+
+  void compact() const
+  {
+    // Compaction is opportunistic: if a writer is already busy then it will
+    // drop the tombstones itself.
+    std::unique_lock<mutex_t> lock{write_mutex, std::defer_lock};
+    if (!stats.try_lock(lock))
+      return;
+
+    write_scope scope;
+    rebuild(owner{nullptr, 0});
+
+    // The tombstones may have been left by a connection group, whose
+    // functions are only destroyed along with their states, so advance once
+    // more to release them now if no other emit is visiting them.
+    reclaim(reclaimer.advance());
+  }
+
+  // Must be called with write_mutex held. Publish a table of the owners which
+  // are still connected, with the new connection inserted after those of
+  // equal or higher priority, if there is one.
+  void rebuild(owner connection) const
+  {
+    owner_list_t removed{memory};
+
+    // Close the gaps left by the removed owners in place.
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < owners.size(); ++i)
+    {
+      if (!owners[i].connection->is_connected())
+      {
+        removed.push_back(std::move(owners[i]));
+        continue;
+      }
+
+      if (i != live)
+        owners[live] = std::move(owners[i]);
+      ++live;
+    }
+    owners.resize(live);
+
+    if (connection.connection)
+    {
+      auto position = std::find_if(owners.begin(), owners.end(),
+        [&](const owner& o) { return o.priority < connection.priority; });
+      owners.insert(position, std::move(connection));
+    }
+
+    auto next = make_resource_ptr<slot_table_t>(memory, memory);
+    next->reserve(owners.size());
+    for (const owner& o : owners)
+      next->push_back(o.connection.get());
+
+    published_size.store(owners.size(), std::memory_order_relaxed);
+    disconnects.store(0, std::memory_order_relaxed);
+
+    stats.reaped(removed.size());
+    publish(std::move(next), std::move(removed));
+  }
+
+  struct write_scope
+  {
+    write_scope() { ++write_depth(); }
+    ~write_scope() { --write_depth(); }
+    write_scope(const write_scope&) = delete;
+    write_scope& operator=(const write_scope&) = delete;
+  };
 
-  mutable std::mutex connections_mutex;
-  mutable connection_list_t connections;
+  memory_resource* const memory;
+  atomic_t<bool> open{true};
+  mutable mutex_t write_mutex;
+  mutable atomic_t<const slot_table_t*> table{nullptr};
+  mutable reclaimer_t reclaimer;
+  mutable owner_list_t owners;
 
-  mutable std::mutex persistent_connections_mutex;
-  mutable persistent_connection_list_t persistent_connections;
+  // The size of the published table, and the number of its connections which
+  // have been disconnected since, which decide when a disconnection compacts.
+  mutable atomic_t<std::size_t> published_size{0};
+  mutable atomic_t<std::size_t> disconnects{0};
+  mutable std::vector<retired_table, resource_allocator<retired_table>>
+    retired;
+  mutable signal_stats stats;
 };
 
 //------------------------------------------------------------------------------
@@ -1,10 +1,28 @@
 #ifndef SLOT_STATE_HPP
 #define SLOT_STATE_HPP
 
+#include "../batch.hpp"
+#include "../connection.hpp"
+#include "../inplace_function.hpp"
+#include "../instrumentation.hpp"
+#include "../memory_resource.hpp"
+#include "../tags.hpp"
+#include "mpmc_queue.hpp"
+#include "task.hpp"
+#include "threading.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -16,79 +34,903 @@ namespace detail {
 
 //------------------------------------------------------------------------------
 
+///
+/// \brief The function of a slot, which is one of three kinds: an ordinary
+/// function, a batch-aware function or a short-circuiting handler. They share
+/// a single buffer, so a slot is no bigger than one function.
+///
 template <class... Params>
-class slot_state : public std::enable_shared_from_this<slot_state<Params...>>
+class slot_function
 {
 public:
-  using function_t = std::function<void(Params...)>;
+  using function_t = inplace_function<void(Params...)>;
+  using batch_function_t = inplace_function<void(const batch<Params...>&)>;
+  using handler_function_t = inplace_function<bool(Params...)>;
 
-  template <class Executor>
-  slot_state(Executor& executor, function_t fn)
-    : executor(std::make_unique<executor_model>(executor))
-    , fn(std::move(fn))
+  slot_function(function_t f)
+    : fn(std::move(f))
+    , which(kind::function)
   { }
 
-  slot_state(function_t fn)
-    : executor(std::make_unique<inline_executor>())
-    , fn(std::move(fn))
+  slot_function(batch_function_t f)
+    : batch_fn(std::move(f))
+    , which(kind::batch)
   { }
 
+  slot_function(handler_function_t f)
+    : handler_fn(std::move(f))
+    , which(kind::handler)
+  { }
+
+  slot_function(const slot_function&) = delete;
+  slot_function& operator=(const slot_function&) = delete;
+
+  ~slot_function()
+  {
+    switch (which)
+    {
+    case kind::function:
+      fn.~function_t();
+      break;
+    case kind::batch:
+      batch_fn.~batch_function_t();
+      break;
+    case kind::handler:
+      handler_fn.~handler_function_t();
+      break;
+    }
+  }
+
+  ///
+  /// \brief The function, if it's an ordinary one and hasn't been reset.
+  ///
+  const function_t* function() const
+  {
+    return which == kind::function && fn ? &fn : nullptr;
+  }
+
+  ///
+  /// \brief The function, if it's batch-aware and hasn't been reset.
+  ///
+  const batch_function_t* batch_function() const
+  {
+    return which == kind::batch && batch_fn ? &batch_fn : nullptr;
+  }
+
+  ///
+  /// \brief The function, if it's a handler and hasn't been reset.
+  ///
+  const handler_function_t* handler() const
+  {
+    return which == kind::handler && handler_fn ? &handler_fn : nullptr;
+  }
+
+  ///
+  /// \brief Destroy the function, whichever kind it is.
+  ///
   void reset()
   {
-    std::unique_lock<std::mutex> lock{mutex};
-    fn = nullptr;
+    switch (which)
+    {
+    case kind::function:
+      fn = nullptr;
+      break;
+    case kind::batch:
+      batch_fn = nullptr;
+      break;
+    case kind::handler:
+      handler_fn = nullptr;
+      break;
+    }
   }
 
+private:
+  enum class kind : unsigned char { function, batch, handler };
+
+  union
+  {
+    function_t fn;
+    batch_function_t batch_fn;
+    handler_function_t handler_fn;
+  };
+
+  const kind which;
+};
+
+//------------------------------------------------------------------------------
+
+// The slot states whose functions the calling thread is invoking, innermost
+// first, so that a slot which is reset from within its own function can tell
+// that it mustn't wait for the invocation or destroy the function.
+struct invocation_record
+{
+  const void* state;
+  invocation_record* outer;
+};
+
+inline invocation_record*& innermost_invocation()
+{
+  thread_local invocation_record* record = nullptr;
+  return record;
+}
+
+//------------------------------------------------------------------------------
+
+// The class is final so that calls to the connection_state overrides, like
+// is_connected() during an emit, aren't virtual.
+template <class Policy, class... Params>
+class slot_state final
+  : public connection_state
+  , public std::enable_shared_from_this<slot_state<Policy, Params...>>
+{
+public:
+  using function_t = typename slot_function<Params...>::function_t;
+  using batch_t = batch<Params...>;
+  using batch_function_t = typename slot_function<Params...>::batch_function_t;
+  using handler_function_t =
+    typename slot_function<Params...>::handler_function_t;
+  using event_t = typename batch_t::value_type;
+  using shared_event_t = std::shared_ptr<const event_t>;
+
+  template <class Executor>
+  slot_state(memory_resource* memory, Executor& executor, function_t fn)
+    : memory(memory)
+    , executor(submitter(executor))
+    , callable(std::move(fn))
+  { }
+
+  slot_state(memory_resource* memory, function_t fn)
+    : memory(memory)
+    , callable(std::move(fn))
+  { }
+
+  template <class Executor>
+  slot_state(memory_resource* memory, Executor& executor,
+             batch_function_t batch_fn)
+    : memory(memory)
+    , executor(submitter(executor))
+    , callable(std::move(batch_fn))
+  { }
+
+  slot_state(memory_resource* memory, batch_function_t batch_fn)
+    : memory(memory)
+    , callable(std::move(batch_fn))
+  { }
+
+  template <class Executor>
+  slot_state(memory_resource* memory, reentrant_t, Executor& executor,
+             function_t fn)
+    : memory(memory)
+    , executor(submitter(executor))
+    , reentrant(true)
+    , callable(std::move(fn))
+  { }
+
+  slot_state(memory_resource* memory, reentrant_t, function_t fn)
+    : memory(memory)
+    , reentrant(true)
+    , callable(std::move(fn))
+  { }
+
+  slot_state(memory_resource* memory, short_circuit_t,
+             handler_function_t handler_fn)
+    : memory(memory)
+    , callable(std::move(handler_fn))
+  { }
+
+  template <class Executor>
+  slot_state(memory_resource* memory, conflated_t, Executor& executor,
+             function_t fn)
+    : memory(memory)
+    , executor(submitter(executor))
+    , latest(make_resource_ptr<latest_event>(memory, memory))
+    , callable(std::move(fn))
+  { }
+
+  template <class Executor>
+  slot_state(memory_resource* memory, bounded_t options, Executor& executor,
+             function_t fn)
+    : memory(memory)
+    , executor(submitter(executor))
+    , box(make_resource_ptr<mailbox>(memory, memory, options))
+    , callable(std::move(fn))
+  { }
+
+  ///
+  /// \brief Disconnect the slot and destroy its function. Blocks until any
+  /// invocations in other threads have finished. From within the slot's own
+  /// function, it only disconnects the slot, as disconnect() does.
+  ///
+  void reset() override
+  {
+    if (is_invoking())
+    {
+      disconnect();
+      return;
+    }
+
+    connected.store(false, std::memory_order_seq_cst);
+
+    if (reentrant)
+    {
+      // Invocations which start from now on will see that the slot has been
+      // disconnected, so it only remains to wait for those in flight. A
+      // single-threaded slot has none, since this thread isn't invoking it.
+      while (threading_t::concurrent &&
+             in_flight.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+
+      callable.reset();
+    }
+    else
+    {
+      std::unique_lock<mutex_t> lock{mutex};
+      callable.reset();
+    }
+
+    if (latest)
+    {
+      std::unique_lock<mutex_t> lock{latest->mutex};
+      latest->event = nullptr;
+    }
+
+    if (box)
+    {
+      while (box->events.try_consume([](event_t&&){ }))
+      { }
+    }
+
+    notify_owners();
+  }
+
+  ///
+  /// \brief Stop the slot receiving signals without waiting for invocations
+  /// in progress, so it may be called from within one. The function is only
+  /// destroyed along with the state.
+  ///
+  void disconnect()
+  {
+    connected.store(false, std::memory_order_seq_cst);
+    notify_owners();
+  }
+
+  ///
+  /// \brief Record a signal which the slot has been connected to, so that
+  /// the signal is told when the slot is disconnected.
+  ///
+  void attach(std::weak_ptr<const connection_owner> owner)
+  {
+    if (group)
+      group->attach(owner);
+
+    std::unique_lock<mutex_t> lock{owners_mutex};
+    if (first_owner.expired())
+    {
+      first_owner = std::move(owner);
+      return;
+    }
+
+    other_owners.erase(
+      std::remove_if(other_owners.begin(), other_owners.end(),
+        [](const std::weak_ptr<const connection_owner>& o)
+        { return o.expired(); }),
+      other_owners.end());
+    other_owners.push_back(std::move(owner));
+  }
+
+  ///
+  /// \brief Whether the slot still wants to receive signals. A disconnected
+  /// state is a tombstone which signals skip until they next compact. A slot
+  /// in a connection group is also disconnected along with its group.
+  ///
+  bool is_connected() const override
+  {
+    return connected.load(std::memory_order_relaxed) &&
+           (!group || group->is_connected());
+  }
+
+  ///
+  /// \brief Put the slot in a connection group, unless it's already been
+  /// connected to a signal outside it. Emits read the group without
+  /// synchronization, so it can't change once the slot is published.
+  /// \return Whether the slot is in the group.
+  ///
+  bool join(const std::shared_ptr<group_state>& group_state)
+  {
+    std::unique_lock<mutex_t> lock{owners_mutex};
+    if (group)
+      return group == group_state;
+
+    if (!first_owner.expired() ||
+        std::any_of(other_owners.begin(), other_owners.end(),
+          [](const std::weak_ptr<const connection_owner>& o)
+          { return !o.expired(); }))
+      return false;
+
+    group = group_state;
+    return true;
+  }
+
+  ///
+  /// \brief The number of emits which found a bounded slot's mailbox full.
+  ///
+  std::size_t overflow_count() const
+  {
+    return box ? box->overflows.load(std::memory_order_relaxed) : 0;
+  }
+
+  void set_metrics_name(std::string name)
+  {
+    stats.set_name(std::move(name));
+  }
+
+  ///
+  /// \brief Deliver the arguments of an emit.
+  /// \return Whether the slot handled the event, so that slots after it
+  /// shouldn't receive it. Only a short-circuiting slot can handle an event.
+  ///
   template <class... Args>
-  void post(Args&&... args) const
+  bool post(Args&&... args) const
   {
-    std::weak_ptr<const slot_state> weak_state(this->shared_from_this());
+    // Slots without an executor are invoked directly on the emitting thread,
+    // so there is no need to build (and allocate) a closure for them.
+    if (!executor)
+      return execute(std::forward<Args>(args)...);
 
-    auto lock_and_execute = [weak_state](Args... args)
+    if (latest)
     {
-      if (auto state = weak_state.lock())
-        state->execute(std::forward<Args>(args)...);
-    };
+      post_latest(event_t{std::forward<Args>(args)...});
+      return false;
+    }
+
+    if (box)
+    {
+      post_mailbox(event_t{std::forward<Args>(args)...});
+      return false;
+    }
+
+    // The arguments are stored in the closure once, moving them if they
+    // were passed as rvalues, and moved out again when it's executed.
+    using args_t = std::tuple<typename std::decay<Args>::type...>;
+    submit(args_t{std::forward<Args>(args)...},
+           std::is_copy_constructible<args_t>{});
+    return false;
+  }
+
+  ///
+  /// \brief Deliver an event which is shared by every slot. Slots with an
+  /// executor keep a reference to the event rather than a copy of it.
+  /// \return Whether the slot handled the event.
+  ///
+  bool post_shared(const shared_event_t& event) const
+  {
+    if (!executor)
+      return execute_event(*event);
+
+    if (latest)
+    {
+      post_latest(*event);
+      return false;
+    }
+
+    if (box)
+    {
+      post_mailbox(*event);
+      return false;
+    }
+
+    dispatch([event](const slot_state& state)
+    {
+      state.execute_event(*event);
+    });
+    return false;
+  }
+
+  ///
+  /// \brief Deliver all of the events from a call to emit_batch(). The slot is
+  /// locked once for the whole batch, and at most one closure is submitted to
+  /// its executor.
+  ///
+  template <class Range>
+  void post_batch(const batch_source<Range, Params...>& source) const
+  {
+    if (!executor)
+    {
+      invocation guard{*this};
+      if (!guard)
+        return;
+
+      slot_stats::invocation_timer timer{stats};
+      if (auto fn = callable.function())
+      {
+        for (const auto& event : source.range())
+          source.apply(*fn, event);
+      }
+      else if (auto handler_fn = callable.handler())
+      {
+        for (const auto& event : source.range())
+          source.apply(*handler_fn, event);
+      }
+      else if (auto batch_fn = callable.batch_function())
+      {
+        (*batch_fn)(source.view());
+      }
+      return;
+    }
+
+    if (latest)
+    {
+      // Only the last event in the batch matters to a conflated slot.
+      auto it = std::begin(source.range());
+      auto end = std::end(source.range());
+      if (it == end)
+        return;
+
+      auto last = it;
+      while (++it != end)
+        last = it;
+
+      post_latest(event_t(*last));
+      return;
+    }
+
+    if (box)
+    {
+      for (const auto& event : source.range())
+        post_mailbox(event_t(event));
+      return;
+    }
+
+    auto events = source.shared();
 
-    executor->submit(std::bind(lock_and_execute, std::forward<Args>(args)...));
+    dispatch([events](const slot_state& state)
+    {
+      state.execute_events(*events);
+    });
   }
 
 private:
-  struct executor_concept
+  using threading_t = threading<Policy>;
+  using mutex_t = typename threading_t::mutex_t;
+
+  template <class T>
+  using atomic_t = typename threading_t::template atomic_t<T>;
+
+  // A closure which is about to be submitted. It's only wrapped once the
+  // executor is known, either in a std::function or, for executors which take
+  // them, like bb::thread_pool_executor, in a task, so that either way it's
+  // allocated once.
+  class pending_closure
+  {
+  public:
+    virtual std::function<void()> function() = 0;
+    virtual std::unique_ptr<task> make_task() = 0;
+
+  protected:
+    ~pending_closure() = default;
+  };
+
+  template <class Closure>
+  class pending_closure_model final : public pending_closure
   {
-    virtual void submit(std::function<void()>) = 0;
+  public:
+    explicit pending_closure_model(Closure& closure)
+      : closure(closure)
+    { }
+
+    std::function<void()> function() override
+    {
+      return std::move(closure);
+    }
+
+    std::unique_ptr<task> make_task() override
+    {
+      return detail::make_task(std::move(closure));
+    }
+
+  private:
+    Closure& closure;
   };
 
+  template <class Executor, class = void>
+  struct accepts_tasks : std::false_type
+  { };
+
   template <class Executor>
-  struct executor_model : executor_concept
+  struct accepts_tasks<Executor, void_t<decltype(std::declval<Executor&>()
+    .submit(std::declval<std::unique_ptr<task>>()))>>
+    : std::true_type
+  { };
+
+  // Submits closures to the slot's executor. It only refers to the executor,
+  // so it only needs room for a pointer.
+  using executor_t = inplace_function<void(pending_closure&), sizeof(void*),
+                                       alignof(void*)>;
+
+  template <class Executor>
+  static executor_t submitter(Executor& executor)
   {
-    Executor& executor;
+    return [&executor](pending_closure& closure)
+    {
+      submit_to(executor, closure, accepts_tasks<Executor>{});
+    };
+  }
+
+  template <class Executor>
+  static void submit_to(Executor& executor, pending_closure& closure,
+                        std::true_type)
+  {
+    executor.submit(closure.make_task());
+  }
+
+  template <class Executor>
+  static void submit_to(Executor& executor, pending_closure& closure,
+                        std::false_type)
+  {
+    executor.submit(closure.function());
+  }
+
+  using events_t = std::vector<event_t>;
+  using owner_allocator_t =
+    resource_allocator<std::weak_ptr<const connection_owner>>;
+  using owner_list_t =
+    std::vector<std::weak_ptr<const connection_owner>, owner_allocator_t>;
+
+  // Tell the signals which the slot was connected to that it has become a
+  // tombstone, so that they can compact without waiting for an emit.
+  void notify_owners()
+  {
+    std::weak_ptr<const connection_owner> first;
+    owner_list_t others{other_owners.get_allocator()};
+    {
+      std::unique_lock<mutex_t> lock{owners_mutex};
+      first = std::move(first_owner);
+      others.swap(other_owners);
+    }
 
-    void submit(std::function<void()> closure) override
+    if (auto owner = first.lock())
+      owner->disconnected(1);
+    for (const auto& other : others)
     {
-      executor.submit(std::move(closure));
+      if (auto owner = other.lock())
+        owner->disconnected(1);
     }
+  }
+
+  // Submit a closure which calls fn with the state, unless the state has been
+  // destroyed by the time the closure runs.
+  template <class Fn>
+  void dispatch(Fn fn) const
+  {
+    std::weak_ptr<const slot_state> weak_state(this->shared_from_this());
+    auto ticket = stats.enqueued();
+
+    auto closure = [weak_state, ticket, fn = std::move(fn)]() mutable
+    {
+      if (auto state = weak_state.lock())
+      {
+        state->stats.dequeued(ticket);
+        fn(*state);
+      }
+    };
+
+    pending_closure_model<decltype(closure)> pending{closure};
+    executor(pending);
+  }
+
+  template <class Tuple>
+  void submit(Tuple&& args, std::true_type) const
+  {
+    dispatch([args = std::move(args)](const slot_state& state) mutable
+    {
+      state.execute_tuple(std::move(args));
+    });
+  }
+
+  template <class Tuple>
+  void submit(Tuple&& args, std::false_type) const
+  {
+    // Executors take copyable closures, so move-only arguments have to be
+    // shared between the copies.
+    auto shared_args = std::make_shared<Tuple>(std::move(args));
+
+    dispatch([shared_args](const slot_state& state)
+    {
+      state.execute_tuple(std::move(*shared_args));
+    });
+  }
+
+  // The most recent event for a conflated slot, and whether a closure to
+  // deliver it has been submitted but hasn't run yet.
+  struct latest_event
+  {
+    explicit latest_event(memory_resource* memory)
+      : event(nullptr, resource_deleter<event_t>{memory})
+    { }
+
+    mutex_t mutex;
+    resource_ptr<event_t> event;
+    bool pending = false;
   };
 
-  struct inline_executor : executor_concept
+  // Store the event as the slot's latest, overwriting the previous one if it
+  // hasn't been delivered yet, and submit a closure to deliver it unless one
+  // is already pending.
+  void post_latest(event_t event) const
   {
-    void submit(std::function<void()> closure) override
     {
-      closure();
+      std::unique_lock<mutex_t> lock{latest->mutex};
+      if (latest->event)
+        *latest->event = std::move(event);
+      else
+        latest->event = make_resource_ptr<event_t>(memory, std::move(event));
+
+      if (latest->pending)
+        return;
+      latest->pending = true;
     }
+
+    dispatch([](const slot_state& state)
+    {
+      state.execute_latest();
+    });
+  }
+
+  void execute_latest() const
+  {
+    std::unique_lock<mutex_t> lock{latest->mutex};
+    latest->pending = false;
+    if (!latest->event)
+      return;
+
+    // The storage is kept for the next event, so only its value is taken.
+    event_t event(std::move(*latest->event));
+    lock.unlock();
+
+    execute_tuple(std::move(event));
+  }
+
+  // The queued events for a bounded slot, and whether a closure to drain them
+  // has been submitted but hasn't finished yet.
+  struct mailbox
+  {
+    mailbox(memory_resource* memory, bounded_t options)
+      : events(options.capacity, memory)
+      , policy(options.policy)
+    { }
+
+    mpmc_queue<event_t> events;
+    const overflow policy;
+    std::atomic<bool> scheduled{false};
+    std::atomic<std::size_t> overflows{0};
   };
 
+  void post_mailbox(event_t event) const
+  {
+    if (!box->events.try_push(std::move(event)))
+    {
+      box->overflows.fetch_add(1, std::memory_order_relaxed);
+
+      switch (box->policy)
+      {
+      case overflow::block:
+        while (!box->events.try_push(std::move(event)))
+          std::this_thread::yield();
+        break;
+      case overflow::drop_newest:
+        return;
+      case overflow::drop_oldest:
+        while (!box->events.try_push(std::move(event)))
+          box->events.try_consume([](event_t&&){ });
+        break;
+      }
+    }
+
+    schedule_mailbox();
+  }
+
+  // Submit a closure to drain the mailbox, unless one is already scheduled.
+  void schedule_mailbox() const
+  {
+    if (box->scheduled.exchange(true, std::memory_order_seq_cst))
+      return;
+
+    dispatch([](const slot_state& state)
+    {
+      state.drain_mailbox();
+    });
+  }
+
+  void drain_mailbox() const
+  {
+    // Drain at most a mailbox's worth of events before handing the executor
+    // back, so that a busy slot can't starve others on the same executor.
+    std::size_t limit = box->events.capacity();
+    while (limit-- != 0 &&
+           box->events.try_consume([this](event_t&& event)
+           {
+             execute_tuple(std::move(event));
+           }))
+    { }
+
+    // An emit which pushed an event after the last pop saw that a closure
+    // was still scheduled, so check again once it's been cleared.
+    box->scheduled.store(false, std::memory_order_seq_cst);
+    if (!box->events.empty())
+      schedule_mailbox();
+  }
+
+  template <class Tuple>
+  void execute_tuple(Tuple&& args) const
+  {
+    execute_tuple(std::move(args),
+                  std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+  }
+
+  template <class Tuple, std::size_t... I>
+  void execute_tuple(Tuple&& args, std::index_sequence<I...>) const
+  {
+    execute(std::get<I>(std::move(args))...);
+  }
+
+  // Guards an invocation of the slot's function, so that reset() can wait
+  // for it to finish. Ordinary slots hold the mutex for the invocation, which
+  // serializes them; reentrant slots only count the invocations in flight.
+  // Slots in a connection group are also counted by the group, unless they're
+  // single-threaded, in which case the group can only be reset between
+  // invocations or from within one.
+  class invocation
+  {
+  public:
+    explicit invocation(const slot_state& state)
+      : state(state)
+      , grouped(threading_t::concurrent && state.group)
+    {
+      bool in_group = grouped ? state.group->enter()
+                              : !state.group || state.group->is_connected();
+
+      if (state.reentrant)
+      {
+        state.in_flight.fetch_add(1, std::memory_order_seq_cst);
+        active = in_group && state.connected.load(std::memory_order_seq_cst);
+      }
+      else
+      {
+        state.mutex.lock();
+        active = in_group && state.connected.load(std::memory_order_relaxed);
+      }
+
+      innermost_invocation() = &record;
+    }
+
+    invocation(const invocation&) = delete;
+    invocation& operator=(const invocation&) = delete;
+
+    ~invocation()
+    {
+      innermost_invocation() = record.outer;
+
+      if (state.reentrant)
+        state.in_flight.fetch_sub(1, std::memory_order_release);
+      else
+        state.mutex.unlock();
+
+      if (grouped)
+        state.group->leave();
+    }
+
+    explicit operator bool() const
+    {
+      return active;
+    }
+
+  private:
+    const slot_state& state;
+    const bool grouped;
+    bool active;
+    invocation_record record{&state, innermost_invocation()};
+  };
+
+  // Whether the calling thread is invoking the slot's function.
+  bool is_invoking() const
+  {
+    for (auto record = innermost_invocation(); record; record = record->outer)
+    {
+      if (record->state == this)
+        return true;
+    }
+    return false;
+  }
+
+  // Returns whether a short-circuiting slot handled the event.
   template <class... Args>
-  void execute(Args&&... args) const
+  bool execute(Args&&... args) const
+  {
+    invocation guard{*this};
+    if (!guard)
+      return false;
+
+    slot_stats::invocation_timer timer{stats};
+    if (auto fn = callable.function())
+    {
+      (*fn)(std::forward<Args>(args)...);
+    }
+    else if (auto handler_fn = callable.handler())
+    {
+      return (*handler_fn)(std::forward<Args>(args)...);
+    }
+    else if (auto batch_fn = callable.batch_function())
+    {
+      // A single emit is delivered to a batch-aware slot as a batch of one.
+      event_t event{std::forward<Args>(args)...};
+      (*batch_fn)(batch_t{&event, 1});
+    }
+    return false;
+  }
+
+  bool execute_event(const event_t& event) const
   {
-    std::unique_lock<std::mutex> lock{mutex};
-    if (fn)
-      fn(std::forward<Args>(args)...);
+    invocation guard{*this};
+    if (!guard)
+      return false;
+
+    slot_stats::invocation_timer timer{stats};
+    if (auto fn = callable.function())
+      apply_tuple(*fn, event);
+    else if (auto handler_fn = callable.handler())
+      return apply_tuple(*handler_fn, event);
+    else if (auto batch_fn = callable.batch_function())
+      (*batch_fn)(batch_t{&event, 1});
+    return false;
   }
 
-  std::unique_ptr<executor_concept> executor;
-  mutable std::mutex mutex;
-  function_t fn;
+  void execute_events(const events_t& events) const
+  {
+    invocation guard{*this};
+    if (!guard)
+      return;
+
+    slot_stats::invocation_timer timer{stats};
+    if (auto fn = callable.function())
+    {
+      for (const auto& event : events)
+        apply_tuple(*fn, event);
+    }
+    else if (auto batch_fn = callable.batch_function())
+    {
+      (*batch_fn)(batch_t{events.data(), events.size()});
+    }
+  }
+
+  // The resource which the state was allocated from, which also allocates
+  // the parts of it allocated separately.
+  memory_resource* const memory;
+
+  // Empty for slots which are invoked inline.
+  executor_t executor;
+
+  // Null unless the slot is conflated.
+  const resource_ptr<latest_event> latest{
+    nullptr, resource_deleter<latest_event>{memory}};
+
+  // Null unless the slot is bounded.
+  const resource_ptr<mailbox> box{nullptr, resource_deleter<mailbox>{memory}};
+
+  // Null unless the slot is in a connection group.
+  std::shared_ptr<group_state> group;
+
+  // The signals which the slot is connected to. Most slots are only connected
+  // to one, so the first is stored without allocating.
+  mutex_t owners_mutex;
+  std::weak_ptr<const connection_owner> first_owner;
+  owner_list_t other_owners{owner_allocator_t{memory}};
+  atomic_t<bool> connected{true};
+  const bool reentrant = false;
+  mutable mutex_t mutex;
+  mutable atomic_t<unsigned> in_flight{0};
+  mutable slot_stats stats;
+
+  slot_function<Params...> callable;
 };
 
 //------------------------------------------------------------------------------
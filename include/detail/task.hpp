@@ -0,0 +1,64 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A type-erased closure which owns its callable directly, so that a
+/// closure can be queued as a single allocation.
+///
+class task
+{
+public:
+  virtual ~task() = default;
+  virtual void run() = 0;
+};
+
+template <class Fn>
+class task_model final : public task
+{
+public:
+  template <class F>
+  explicit task_model(F&& fn)
+    : fn(std::forward<F>(fn))
+  { }
+
+  void run() override
+  {
+    fn();
+  }
+
+private:
+  Fn fn;
+};
+
+template <class F>
+std::unique_ptr<task> make_task(F&& fn)
+{
+  return std::make_unique<task_model<typename std::decay<F>::type>>(
+    std::forward<F>(fn));
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // TASK_HPP
@@ -0,0 +1,415 @@
+#ifndef DETAIL_THREADING_HPP
+#define DETAIL_THREADING_HPP
+
+#include "../threading.hpp"
+#include "epoch.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A mutex which does nothing, for single-threaded policies.
+///
+struct null_mutex
+{
+  void lock() { }
+  bool try_lock() { return true; }
+  void unlock() { }
+};
+
+///
+/// \brief A plain value with the interface of std::atomic, for
+/// single-threaded policies. The memory orders are ignored.
+///
+template <class T>
+class plain_atomic
+{
+public:
+  constexpr plain_atomic(T value)
+    : value(value)
+  { }
+
+  plain_atomic(const plain_atomic&) = delete;
+  plain_atomic& operator=(const plain_atomic&) = delete;
+
+  T load(std::memory_order = std::memory_order_seq_cst) const
+  {
+    return value;
+  }
+
+  void store(T desired, std::memory_order = std::memory_order_seq_cst)
+  {
+    value = desired;
+  }
+
+  T exchange(T desired, std::memory_order = std::memory_order_seq_cst)
+  {
+    T previous = value;
+    value = desired;
+    return previous;
+  }
+
+  bool compare_exchange_strong(T& expected, T desired,
+                               std::memory_order = std::memory_order_seq_cst,
+                               std::memory_order = std::memory_order_seq_cst)
+  {
+    if (value != expected)
+    {
+      expected = value;
+      return false;
+    }
+    value = desired;
+    return true;
+  }
+
+  T fetch_add(T arg, std::memory_order = std::memory_order_seq_cst)
+  {
+    T previous = value;
+    value += arg;
+    return previous;
+  }
+
+  T fetch_sub(T arg, std::memory_order = std::memory_order_seq_cst)
+  {
+    T previous = value;
+    value -= arg;
+    return previous;
+  }
+
+private:
+  T value;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Reclaims objects shared between threads, using an epoch domain of
+/// its own, so that an emit which blocks in a slot only holds back the
+/// reclamation of the signal it's emitting.
+///
+class shared_reclaimer
+{
+public:
+  using epoch_t = epoch_domain::epoch_t;
+
+  class guard : epoch_domain::guard
+  {
+  public:
+    explicit guard(shared_reclaimer& reclaimer)
+      : epoch_domain::guard(reclaimer.domain)
+    { }
+  };
+
+  epoch_t retire_epoch()
+  {
+    return domain.retire_epoch();
+  }
+
+  epoch_t advance()
+  {
+    return domain.advance();
+  }
+
+  static bool is_safe(epoch_t retired, epoch_t current)
+  {
+    return epoch_domain::is_safe(retired, current);
+  }
+
+private:
+  epoch_domain domain;
+};
+
+///
+/// \brief Reclaims objects which are only used by a single thread. Readers
+/// just count themselves, so an object can be destroyed as soon as there are
+/// no reads in progress, e.g. once a nested emit has returned.
+///
+class local_reclaimer
+{
+public:
+  using epoch_t = epoch_domain::epoch_t;
+
+  class guard
+  {
+  public:
+    explicit guard(local_reclaimer& reclaimer)
+      : reclaimer(reclaimer)
+    {
+      ++reclaimer.readers;
+    }
+
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+    ~guard()
+    {
+      --reclaimer.readers;
+    }
+
+  private:
+    local_reclaimer& reclaimer;
+  };
+
+  epoch_t retire_epoch()
+  {
+    return epoch;
+  }
+
+  epoch_t advance()
+  {
+    if (readers == 0)
+      ++epoch;
+    return epoch;
+  }
+
+  static bool is_safe(epoch_t retired, epoch_t current)
+  {
+    return current > retired;
+  }
+
+private:
+  unsigned readers = 0;
+  epoch_t epoch = 0;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Marks a state as being visited by the calling thread, e.g. by an
+/// emit, for the duration of the scope.
+///
+/// Emits only borrow the state when they can, rather than sharing ownership
+/// of it, so a slot could otherwise destroy the state's last owner, such as
+/// its signal, part way through. Owners let go of states with release()
+/// instead, and a state which the calling thread is visiting is then kept
+/// alive by the outermost visit, and destroyed once that visit has finished.
+///
+class visit_scope
+{
+public:
+  explicit visit_scope(const void* state)
+    : state(state)
+    , outer(innermost())
+  {
+    innermost() = this;
+  }
+
+  visit_scope(const visit_scope&) = delete;
+  visit_scope& operator=(const visit_scope&) = delete;
+
+  // The state is only released by the keep_alive member, after the scope has
+  // been popped, so its destructor may visit other states.
+  ~visit_scope()
+  {
+    innermost() = outer;
+  }
+
+  ///
+  /// \brief Let go of an owning reference to a state, which is left empty.
+  ///
+  template <class T>
+  static void release(std::shared_ptr<T>& owner)
+  {
+    visit_scope* outermost = nullptr;
+    for (visit_scope* scope = innermost(); scope; scope = scope->outer)
+    {
+      if (scope->state == owner.get())
+        outermost = scope;
+    }
+
+    if (outermost && !outermost->keep_alive)
+      outermost->keep_alive = std::move(owner);
+    else
+      owner.reset();
+  }
+
+private:
+  static visit_scope*& innermost()
+  {
+    thread_local visit_scope* scope = nullptr;
+    return scope;
+  }
+
+  const void* state;
+  visit_scope* outer;
+  std::shared_ptr<const void> keep_alive;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A weak reference to a state which is owned elsewhere. Locking it
+/// keeps the state alive for as long as the returned pointer.
+///
+template <class Policy, class T>
+class weak_ref;
+
+///
+/// \brief The result of locking a weak reference, which either shares
+/// ownership of the state or borrows a pinned one.
+///
+template <class T>
+class locked_ref
+{
+public:
+  explicit locked_ref(std::shared_ptr<T> owner)
+    : owner(std::move(owner))
+    , raw(this->owner.get())
+  { }
+
+  explicit locked_ref(T* raw)
+    : raw(raw)
+  { }
+
+  explicit operator bool() const
+  {
+    return raw != nullptr;
+  }
+
+  T& operator*() const
+  {
+    return *raw;
+  }
+
+  T* operator->() const
+  {
+    return raw;
+  }
+
+private:
+  std::shared_ptr<T> owner;
+  T* raw;
+};
+
+// Locking a weak_ptr increments and then decrements the state's shared
+// reference count, which bounces its cache line between threads which emit
+// at once. A pinned reference holds the state instead, so locking it only
+// loads the state's open flag, which the owner clears when it closes the
+// state. The pinned state is let go of through visit_scope, since it may be
+// the last owner of a state which is being emitted.
+template <class T>
+class weak_ref<multi_threaded, T>
+{
+public:
+  weak_ref() = default;
+
+  explicit weak_ref(const std::shared_ptr<T>& state)
+    : state(state)
+  { }
+
+  weak_ref(const weak_ref&) = default;
+  weak_ref(weak_ref&&) = default;
+
+  weak_ref& operator=(weak_ref other)
+  {
+    visit_scope::release(pinned);
+    state = std::move(other.state);
+    pinned = std::move(other.pinned);
+    return *this;
+  }
+
+  ~weak_ref()
+  {
+    visit_scope::release(pinned);
+  }
+
+  locked_ref<T> lock() const
+  {
+    if (pinned)
+      return locked_ref<T>{pinned->is_open() ? pinned.get() : nullptr};
+    return locked_ref<T>{state.lock()};
+  }
+
+  void pin()
+  {
+    pinned = state.lock();
+  }
+
+private:
+  std::weak_ptr<T> state;
+  std::shared_ptr<T> pinned;
+};
+
+// Locking only has to check that a single-threaded state is still alive,
+// which is a plain load rather than an atomic increment and decrement. An
+// emit marks the state with a visit_scope, so the state outlives the emit
+// even if a slot destroys its signal.
+template <class T>
+class weak_ref<single_threaded, T>
+{
+public:
+  weak_ref() = default;
+
+  explicit weak_ref(const std::shared_ptr<T>& state)
+    : state(state)
+    , raw(state.get())
+  { }
+
+  T* lock() const
+  {
+    return state.expired() ? nullptr : raw;
+  }
+
+  // Locking is already just a load.
+  void pin()
+  { }
+
+private:
+  std::weak_ptr<T> state;
+  T* raw = nullptr;
+};
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The synchronization primitives used by each threading policy.
+///
+template <class Policy>
+struct threading;
+
+template <>
+struct threading<multi_threaded>
+{
+  static constexpr bool concurrent = true;
+
+  using mutex_t = std::mutex;
+  using reclaimer_t = shared_reclaimer;
+
+  template <class T>
+  using atomic_t = std::atomic<T>;
+};
+
+template <>
+struct threading<single_threaded>
+{
+  static constexpr bool concurrent = false;
+
+  using mutex_t = null_mutex;
+  using reclaimer_t = local_reclaimer;
+
+  template <class T>
+  using atomic_t = plain_atomic<T>;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // DETAIL_THREADING_HPP
@@ -0,0 +1,186 @@
+#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A lock-free Chase-Lev work-stealing deque of pointers.
+///
+/// The owning thread pushes and pops at the bottom, like a stack, and any
+/// other thread can steal from the top. The owner only contends with thieves
+/// when the deque holds a single element. The buffer grows when it's full;
+/// retired buffers are kept until the deque is destroyed, since a thief may
+/// still be reading from one.
+///
+template <class T>
+class work_stealing_deque
+{
+public:
+  explicit work_stealing_deque(std::size_t capacity = 256)
+  {
+    buffers.push_back(std::make_unique<buffer>(capacity));
+    current.store(buffers.back().get(), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(const work_stealing_deque&) = delete;
+  work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+  ///
+  /// \brief Push an element onto the bottom. Must only be called by the
+  /// owner.
+  ///
+  void push(T* element)
+  {
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_acquire);
+    buffer* a = current.load(std::memory_order_relaxed);
+
+    if (b - t > static_cast<std::int64_t>(a->capacity) - 1)
+      a = grow(a, t, b);
+
+    a->put(b, element);
+    bottom.store(b + 1, std::memory_order_release);
+  }
+
+  ///
+  /// \brief Pop an element from the bottom. Must only be called by the
+  /// owner.
+  /// \return The element, or null if the deque is empty.
+  ///
+  T* pop()
+  {
+    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    buffer* a = current.load(std::memory_order_relaxed);
+
+    // The store and the load of top must not be reordered, so that the owner
+    // and a thief can't both take the last element.
+    bottom.store(b, std::memory_order_seq_cst);
+    std::int64_t t = top.load(std::memory_order_seq_cst);
+
+    if (t > b)
+    {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T* element = a->get(b);
+    if (t == b)
+    {
+      // This is the last element, so race the thieves for it.
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        element = nullptr;
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return element;
+  }
+
+  ///
+  /// \brief Steal an element from the top. May be called by any thread.
+  /// \return The element, or null if the deque is empty or another thread
+  /// took the element first.
+  ///
+  T* steal()
+  {
+    std::int64_t t = top.load(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_seq_cst);
+
+    if (t >= b)
+      return nullptr;
+
+    buffer* a = current.load(std::memory_order_acquire);
+    T* element = a->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return nullptr;
+    return element;
+  }
+
+  ///
+  /// \brief Whether the deque appeared to be empty. May be called by any
+  /// thread.
+  ///
+  bool empty() const
+  {
+    std::int64_t t = top.load(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_seq_cst);
+    return t >= b;
+  }
+
+private:
+  struct buffer
+  {
+    explicit buffer(std::size_t capacity)
+      : capacity(capacity)
+      , elements(new std::atomic<T*>[capacity])
+    { }
+
+    // The capacity is always a power of two.
+    std::size_t index(std::int64_t i) const
+    {
+      return static_cast<std::size_t>(i) & (capacity - 1);
+    }
+
+    T* get(std::int64_t i) const
+    {
+      return elements[index(i)].load(std::memory_order_acquire);
+    }
+
+    void put(std::int64_t i, T* element)
+    {
+      elements[index(i)].store(element, std::memory_order_release);
+    }
+
+    const std::size_t capacity;
+    std::unique_ptr<std::atomic<T*>[]> elements;
+  };
+
+  buffer* grow(buffer* a, std::int64_t t, std::int64_t b)
+  {
+    buffers.push_back(std::make_unique<buffer>(a->capacity * 2));
+    buffer* next = buffers.back().get();
+
+    for (std::int64_t i = t; i < b; ++i)
+      next->put(i, a->get(i));
+
+    current.store(next, std::memory_order_release);
+    return next;
+  }
+
+  // Keep the indices on separate cache lines, since the owner writes bottom
+  // and the thieves write top.
+  std::atomic<std::int64_t> top{0};
+  char top_padding[64];
+  std::atomic<std::int64_t> bottom{0};
+  char bottom_padding[64];
+  std::atomic<buffer*> current{nullptr};
+
+  // Only accessed by the owner.
+  std::vector<std::unique_ptr<buffer>> buffers;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // WORK_STEALING_DEQUE_HPP
@@ -2,10 +2,17 @@
 #define EMITTER_HPP
 
 #include "detail/signal_state.hpp"
+#include "detail/threading.hpp"
+#include "memory_resource.hpp"
 #include "signal.hpp"
+#include "tags.hpp"
+#include "threading.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -16,43 +23,119 @@ namespace bb {
 ///
 /// \brief The emitter class is a function object which is used to create and
 /// emit signals.
+/// \tparam Policy The threading policy: multi_threaded or single_threaded.
+/// \tparam Params... The signal parameters.
 ///
-template <class... Params>
-class emitter
+template <class Policy, class... Params>
+class basic_emitter
 {
 public:
   ///
   /// \brief Construct a new emitter.
   ///
-  emitter();
+  basic_emitter();
 
   ///
   /// \brief Copy constructor.
   ///
-  emitter(const emitter&);
+  basic_emitter(const basic_emitter&);
 
   ///
   /// \brief Copy assignment operator.
   ///
-  emitter& operator=(const emitter&);
+  basic_emitter& operator=(const basic_emitter&);
 
   ///
   /// \brief Move constructor.
   ///
-  emitter(emitter&&);
+  basic_emitter(basic_emitter&&);
 
   ///
   /// \brief Move assignment operator.
   ///
-  emitter& operator=(emitter&&);
+  basic_emitter& operator=(basic_emitter&&);
 
   ///
   /// \brief emit any signals which have been created.
-  /// \param args The arguments with which to emit the signal.
+  /// \param args The arguments with which to emit the signal. Rvalue
+  /// arguments are moved into the last connected slot, and passed by
+  /// reference to the others. Every parameter must be initializable from an
+  /// lvalue; move-only arguments can only be emitted with emit_to_last().
   ///
   template <class... Args>
   void operator()(Args&&... args);
 
+  ///
+  /// \brief Emit a signal to the last connected slot only, moving the
+  /// arguments into it. This is how arguments of a move-only parameter type
+  /// are emitted, since they can only be delivered once. If the emitter is
+  /// joined to several signals, only the last of them which is still alive
+  /// is emitted to.
+  /// \param args The arguments with which to emit the signal.
+  ///
+  template <class... Args>
+  void emit_to_last(Args&&... args);
+
+  ///
+  /// \brief Emit a signal whose arguments are materialized once, into an
+  /// immutable, reference-counted event which every slot shares. Slots with
+  /// an executor hold a reference to the event rather than each capturing
+  /// their own copy of the arguments, so the cost of fanning out to many
+  /// executors doesn't grow with the number of slots.
+  /// \param args The arguments with which to emit the signal. Every parameter
+  /// must be initializable from a const lvalue.
+  ///
+  template <class... Args>
+  void emit_shared(Args&&... args);
+
+  ///
+  /// \brief Emit a sequence of signals in one pass. Each slot is dispatched
+  /// once for the whole batch: batch-aware slots receive all of the events at
+  /// once, and slots with an executor have a single closure submitted.
+  /// \param events A range of events. For signals with a single parameter
+  /// each element is the argument; otherwise each element is a tuple of the
+  /// arguments.
+  ///
+  template <class Range>
+  void emit_batch(const Range& events);
+
+  ///
+  /// \brief Emit a signal to a large number of slots in parallel. The slots
+  /// are split into chunks, which are run by the calling thread and by
+  /// closures submitted to the executor, and the call returns once every
+  /// chunk has finished. The arguments are materialized once, as for
+  /// emit_shared(), and every chunk shares the event.
+  /// \param executor The executor with which to run chunks, such as
+  /// bb::default_thread_pool(). The slots are split between the calling
+  /// thread and as many closures as the executor has threads, according to
+  /// its size(), or as there are hardware threads if it doesn't have one. The
+  /// calling thread runs any chunks which the executor doesn't get to first,
+  /// so it may be called from one of the executor's own threads.
+  /// \param args The arguments with which to emit the signal. Every parameter
+  /// must be initializable from a const lvalue.
+  /// \note Slots are invoked concurrently, in no particular order, and the
+  /// emit isn't short-circuited. Slots with an executor are posted to as
+  /// usual. Only multi_threaded signals can be emitted in parallel. If a slot
+  /// throws, chunks which haven't started are skipped, and the exception is
+  /// rethrown once every chunk in progress has finished.
+  ///
+  template <class Executor, class... Args>
+  void emit_parallel(Executor& executor, Args&&... args);
+
+  ///
+  /// \brief Pin the states of the emitter's signals, so that each emit only
+  /// checks whether the signals are still alive with a plain load, rather
+  /// than by locking a weak reference. Locking increments and decrements a
+  /// reference count shared by every emitter of the signal, so pinning stops
+  /// emits on different threads contending for it. Signals joined later are
+  /// pinned too, until the emitter is connected again.
+  /// \note The emitter then shares ownership of each signal's state, though
+  /// not of its connections, until the emitter is destroyed. A slot may still
+  /// destroy the emitter and its signal during an emit: the state is then
+  /// destroyed once the emit has finished.
+  ///
+  void pin();
+
   ///
   /// \brief Connect an emitter to a signal, so that calling the emitter will
   /// trigger any slots connected to the signal.
@@ -61,59 +144,305 @@ public:
   /// \note Existing connections from the emitter and the signal will be
   /// destroyed.
   ///
-  template <class... T>
-  friend void connect(emitter<T...>& emitter, signal<T...>& signal);
+  template <class P, class... T>
+  friend void connect(basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal);
+
+  ///
+  /// \brief Connect an emitter to a signal, allocating their shared state,
+  /// its slot tables and any function connections from the given memory
+  /// resource, such as a bb::arena, rather than the heap.
+  /// \param resource The resource, which must outlive the emitter, the signal
+  /// and every connection made through the signal.
+  /// \param emitter The sending emitter.
+  /// \param signal The receiving signal.
+  ///
+  template <class P, class... T>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal);
+
+  ///
+  /// \brief Join an emitter to a signal, so that calling the emitter will
+  /// also trigger the slots connected to the signal. Unlike connect() without
+  /// the tag, the existing connections of both are kept: the emitter shares
+  /// the signal's state with any other emitters joined or connected to it,
+  /// and emits to it directly, after its other signals.
+  /// \param emitter The sending emitter.
+  /// \param signal The receiving signal, which is given a state if it doesn't
+  /// have one yet.
+  /// \note Each signal is emitted to independently, so a short-circuiting
+  /// slot only stops the emit to its own signal.
+  ///
+  template <class P, class... T>
+  friend void connect(basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal, join_t);
+
+  ///
+  /// \brief Join an emitter to a signal, allocating the signal's state from
+  /// the given memory resource if it doesn't have one yet.
+  /// \param resource The resource, which must outlive the signal and every
+  /// connection made through it.
+  /// \param emitter The sending emitter.
+  /// \param signal The receiving signal.
+  ///
+  template <class P, class... T>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal, join_t);
 
 private:
-  using state_t = detail::signal_state<Params...>;
-  using weak_state_t = std::weak_ptr<state_t>;
+  using state_t = detail::signal_state<Policy, Params...>;
+  using weak_state_t = detail::weak_ref<Policy, state_t>;
 
-  emitter(weak_state_t);
+  // Whether the arguments can be passed to more than one slot or signal.
+  using can_share_arguments = std::integral_constant<bool,
+    detail::all_of<std::is_constructible<
+      Params, typename std::decay<Params>::type&>::value...>::value>;
+
+  basic_emitter(weak_state_t);
+
+  // Add a signal's state to the emitter's targets, unless it's already one.
+  void join(const std::shared_ptr<state_t>& state);
+
+  template <class... Args>
+  void emit_joined(Args&&... args);
 
   weak_state_t weak_state;
+  bool pinned = false;
+
+  // The states of any signals joined after the first, which are emitted to
+  // in order after it. Empty unless the emitter has been joined to several
+  // signals, so a one-to-one emitter only pays for the check.
+  std::vector<weak_state_t> joined;
 };
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-emitter<Params...>::emitter(weak_state_t weak_state)
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>::basic_emitter(weak_state_t weak_state)
   : weak_state{std::move(weak_state)}
 {
 }
 
-template <class... Params>
-emitter<Params...>::emitter() = default;
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>::basic_emitter() = default;
 
-template <class... Params>
-emitter<Params...>::emitter(const emitter&) = default;
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>::basic_emitter(const basic_emitter&) = default;
 
-template <class... Params>
-emitter<Params...>& emitter<Params...>::operator=(const emitter&) = default;
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>&
+basic_emitter<Policy, Params...>::operator=(const basic_emitter&) = default;
 
-template <class... Params>
-emitter<Params...>::emitter(emitter&&) = default;
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>::basic_emitter(basic_emitter&&) = default;
 
-template <class... Params>
-emitter<Params...>& emitter<Params...>::operator=(emitter&&) = default;
+template <class Policy, class... Params>
+basic_emitter<Policy, Params...>&
+basic_emitter<Policy, Params...>::operator=(basic_emitter&&) = default;
 
-template <class... Params>
-void connect(emitter<Params...>& emitter_, signal<Params...>& signal_)
+template <class Policy, class... Params>
+void connect(basic_emitter<Policy, Params...>& emitter_,
+             basic_signal<Policy, Params...>& signal_)
 {
-  using state_t = typename emitter<Params...>::state_t;
-  using weak_state_t = typename emitter<Params...>::weak_state_t;
-  auto state = std::make_shared<state_t>();
-  emitter_ = emitter<Params...>{weak_state_t{state}};
-  signal_ = signal<Params...>{state};
+  connect(std::allocator_arg, *new_delete_resource(), emitter_, signal_);
 }
 
-template <class... Params>
+template <class Policy, class... Params>
+void connect(std::allocator_arg_t, memory_resource& resource,
+             basic_emitter<Policy, Params...>& emitter_,
+             basic_signal<Policy, Params...>& signal_)
+{
+  using emitter_t = basic_emitter<Policy, Params...>;
+  using state_t = typename emitter_t::state_t;
+  using weak_state_t = typename emitter_t::weak_state_t;
+  auto state = std::allocate_shared<state_t>(
+    resource_allocator<state_t>{&resource}, &resource);
+  emitter_ = emitter_t{weak_state_t{state}};
+  signal_ = basic_signal<Policy, Params...>{state};
+}
+
+template <class Policy, class... Params>
+void connect(basic_emitter<Policy, Params...>& emitter,
+             basic_signal<Policy, Params...>& signal, join_t)
+{
+  connect(std::allocator_arg, *new_delete_resource(), emitter, signal, join);
+}
+
+template <class Policy, class... Params>
+void connect(std::allocator_arg_t, memory_resource& resource,
+             basic_emitter<Policy, Params...>& emitter,
+             basic_signal<Policy, Params...>& signal, join_t)
+{
+  using state_t = typename basic_emitter<Policy, Params...>::state_t;
+
+  if (!signal.state)
+  {
+    signal.state = std::allocate_shared<state_t>(
+      resource_allocator<state_t>{&resource}, &resource);
+  }
+  emitter.join(signal.state);
+}
+
+template <class Policy, class... Params>
+void basic_emitter<Policy, Params...>::join(
+  const std::shared_ptr<state_t>& state)
+{
+  auto is_target = [&](const weak_state_t& target)
+  {
+    auto locked = target.lock();
+    return locked && &*locked == state.get();
+  };
+
+  if (is_target(weak_state) ||
+      std::any_of(joined.begin(), joined.end(), is_target))
+    return;
+
+  // Forget any signals which have been destroyed since they were joined.
+  joined.erase(std::remove_if(joined.begin(), joined.end(),
+    [](const weak_state_t& target) { return !target.lock(); }),
+    joined.end());
+
+  weak_state_t target{state};
+  if (pinned)
+    target.pin();
+
+  if (!weak_state.lock())
+    weak_state = std::move(target);
+  else
+    joined.push_back(std::move(target));
+}
+
+template <class Policy, class... Params>
+void basic_emitter<Policy, Params...>::pin()
+{
+  pinned = true;
+  weak_state.pin();
+  for (weak_state_t& target : joined)
+    target.pin();
+}
+
+template <class Policy, class... Params>
 template <class... Args>
-void emitter<Params...>::operator()(Args&&... args)
+void basic_emitter<Policy, Params...>::operator()(Args&&... args)
 {
+  static_assert(can_share_arguments::value,
+                "move-only arguments can only be delivered to one slot, so "
+                "they must be emitted with emit_to_last()");
+
+  if (!joined.empty())
+  {
+    emit_joined(std::forward<Args>(args)...);
+    return;
+  }
+
   if (auto state = weak_state.lock())
     state->emit(std::forward<Args>(args)...);
 }
 
+// Every signal but the last receives the arguments as lvalues, and they are
+// forwarded to the last one, as for the slots of a single signal.
+template <class Policy, class... Params>
+template <class... Args>
+void basic_emitter<Policy, Params...>::emit_joined(Args&&... args)
+{
+  if (auto state = weak_state.lock())
+    state->emit(args...);
+
+  for (std::size_t i = 0; i + 1 < joined.size(); ++i)
+  {
+    if (auto state = joined[i].lock())
+      state->emit(args...);
+  }
+
+  if (auto state = joined.back().lock())
+    state->emit(std::forward<Args>(args)...);
+}
+
+// The arguments are delivered to a single signal, the last one which is still
+// alive.
+template <class Policy, class... Params>
+template <class... Args>
+void basic_emitter<Policy, Params...>::emit_to_last(Args&&... args)
+{
+  for (auto it = joined.rbegin(); it != joined.rend(); ++it)
+  {
+    if (auto state = it->lock())
+    {
+      state->emit_to_last(std::forward<Args>(args)...);
+      return;
+    }
+  }
+
+  if (auto state = weak_state.lock())
+    state->emit_to_last(std::forward<Args>(args)...);
+}
+
+template <class Policy, class... Params>
+template <class... Args>
+void basic_emitter<Policy, Params...>::emit_shared(Args&&... args)
+{
+  if (joined.empty())
+  {
+    if (auto state = weak_state.lock())
+      state->emit_shared(std::forward<Args>(args)...);
+    return;
+  }
+
+  // Each signal materializes its own event from the arguments.
+  if (auto state = weak_state.lock())
+    state->emit_shared(args...);
+
+  for (const weak_state_t& target : joined)
+  {
+    if (auto state = target.lock())
+      state->emit_shared(args...);
+  }
+}
+
+template <class Policy, class... Params>
+template <class Executor, class... Args>
+void basic_emitter<Policy, Params...>::emit_parallel(Executor& executor,
+                                                     Args&&... args)
+{
+  if (joined.empty())
+  {
+    if (auto state = weak_state.lock())
+      state->emit_parallel(executor, std::forward<Args>(args)...);
+    return;
+  }
+
+  if (auto state = weak_state.lock())
+    state->emit_parallel(executor, args...);
+
+  for (const weak_state_t& target : joined)
+  {
+    if (auto state = target.lock())
+      state->emit_parallel(executor, args...);
+  }
+}
+
+template <class Policy, class... Params>
+template <class Range>
+void basic_emitter<Policy, Params...>::emit_batch(const Range& events)
+{
+  if (auto state = weak_state.lock())
+    state->emit_batch(events);
+
+  for (const weak_state_t& target : joined)
+  {
+    if (auto state = target.lock())
+      state->emit_batch(events);
+  }
+}
+
+///
+/// \brief An emitter for signals which may be used from any thread.
+///
+template <class... Params>
+using emitter = basic_emitter<multi_threaded, Params...>;
+
 //------------------------------------------------------------------------------
 
 }
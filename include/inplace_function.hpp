@@ -0,0 +1,411 @@
+#ifndef INPLACE_FUNCTION_HPP
+#define INPLACE_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+///
+/// \brief The default number of bytes which an inplace_function reserves for
+/// its callable. Define this before including any bb-signals header to change
+/// the capacity of the functions used by slots.
+///
+#ifndef BB_SIGNALS_FUNCTION_CAPACITY
+#define BB_SIGNALS_FUNCTION_CAPACITY 64
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+template <class...>
+struct make_void
+{
+  using type = void;
+};
+
+template <class... T>
+using void_t = typename make_void<T...>::type;
+
+template <class F, class Signature, class = void>
+struct is_callable : std::false_type
+{ };
+
+template <class F, class R, class... Args>
+struct is_callable<F, R(Args...),
+  void_t<decltype(std::declval<F&>()(std::declval<Args>()...))>>
+  : std::integral_constant<bool,
+      std::is_void<R>::value ||
+      std::is_convertible<
+        decltype(std::declval<F&>()(std::declval<Args>()...)), R>::value>
+{ };
+
+// Whether a callable is null, and so should make an empty function, as it
+// would a std::function.
+template <class F>
+bool is_null(const F&)
+{
+  return false;
+}
+
+template <class R, class... Args>
+bool is_null(R (* const& fn)(Args...))
+{
+  return fn == nullptr;
+}
+
+template <class T, class M>
+bool is_null(M T::* const& member)
+{
+  return member == nullptr;
+}
+
+template <class Signature>
+bool is_null(const std::function<Signature>& fn)
+{
+  return !fn;
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+template <class Signature,
+          std::size_t Capacity = BB_SIGNALS_FUNCTION_CAPACITY,
+          std::size_t Alignment = alignof(std::max_align_t)>
+class inplace_function;
+
+///
+/// \brief A type-erased function wrapper like std::function, which stores its
+/// callable inside itself rather than on the heap.
+/// \tparam R The return type.
+/// \tparam Args... The parameter types.
+/// \tparam Capacity The number of bytes available to the callable. Callables
+/// which don't fit, or which might throw when moved, are stored on the heap
+/// instead, as std::function would store them.
+/// \tparam Alignment The alignment of the callable storage.
+///
+template <class R, class... Args, std::size_t Capacity, std::size_t Alignment>
+class inplace_function<R(Args...), Capacity, Alignment>
+{
+  static_assert(Capacity >= sizeof(void*) && Alignment % alignof(void*) == 0,
+                "inplace_function must be able to hold a pointer");
+
+public:
+  ///
+  /// \brief Construct an empty function.
+  ///
+  inplace_function() noexcept = default;
+
+  ///
+  /// \brief Construct an empty function.
+  ///
+  inplace_function(std::nullptr_t) noexcept
+  { }
+
+  ///
+  /// \brief Construct a function which stores a copy of the given callable.
+  /// A null function pointer or an empty std::function makes an empty
+  /// function.
+  /// \param fn A copy-constructible callable.
+  ///
+  template <class F,
+            class Fn = typename std::decay<F>::type,
+            class = typename std::enable_if<
+              !std::is_same<Fn, inplace_function>::value &&
+              detail::is_callable<Fn, R(Args...)>::value>::type>
+  inplace_function(F&& fn)
+  {
+    static_assert(std::is_copy_constructible<Fn>::value,
+                  "callable must be copy-constructible");
+
+    if (detail::is_null(fn))
+      return;
+
+    model<Fn>::construct(&storage, std::forward<F>(fn));
+    invoker = &model<Fn>::invoke;
+    manager = &model<Fn>::manage;
+  }
+
+  ///
+  /// \brief Copy constructor.
+  ///
+  inplace_function(const inplace_function& other)
+    : invoker(other.invoker)
+    , manager(other.manager)
+  {
+    if (manager)
+      manager(operation::copy, &storage, const_cast<storage_t*>(&other.storage));
+  }
+
+  ///
+  /// \brief Move constructor. The moved-from function is left empty.
+  ///
+  inplace_function(inplace_function&& other) noexcept
+    : invoker(other.invoker)
+    , manager(other.manager)
+  {
+    if (manager)
+    {
+      manager(operation::move, &storage, &other.storage);
+      other.invoker = &empty_invoke;
+      other.manager = nullptr;
+    }
+  }
+
+  ///
+  /// \brief Copy assignment operator.
+  ///
+  inplace_function& operator=(const inplace_function& other)
+  {
+    if (this != &other)
+    {
+      inplace_function copy{other};
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  ///
+  /// \brief Move assignment operator. The moved-from function is left empty.
+  ///
+  inplace_function& operator=(inplace_function&& other) noexcept
+  {
+    if (this != &other)
+    {
+      clear();
+      if (other.manager)
+      {
+        other.manager(operation::move, &storage, &other.storage);
+        invoker = other.invoker;
+        manager = other.manager;
+        other.invoker = &empty_invoke;
+        other.manager = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  ///
+  /// \brief Destroy the stored callable, leaving the function empty.
+  ///
+  inplace_function& operator=(std::nullptr_t) noexcept
+  {
+    clear();
+    return *this;
+  }
+
+  ~inplace_function()
+  {
+    clear();
+  }
+
+  ///
+  /// \brief Whether the function holds a callable.
+  ///
+  explicit operator bool() const noexcept
+  {
+    return manager != nullptr;
+  }
+
+  ///
+  /// \brief Invoke the stored callable.
+  /// \throw std::bad_function_call If the function is empty.
+  ///
+  R operator()(Args... args) const
+  {
+    return invoker(const_cast<storage_t*>(&storage),
+                   std::forward<Args>(args)...);
+  }
+
+  ///
+  /// \brief Create a function which calls a member function on an object,
+  /// without storing a member function pointer: the call is resolved at
+  /// compile time.
+  /// \tparam T The class of the object.
+  /// \tparam Method The member function to call.
+  /// \param object The object, which must outlive the function.
+  ///
+  template <class T, R (T::*Method)(Args...)>
+  static inplace_function bind(T& object)
+  {
+    return inplace_function{member<T, Method>{&object}};
+  }
+
+  ///
+  /// \brief Create a function which calls a const member function on an
+  /// object.
+  /// \tparam T The class of the object.
+  /// \tparam Method The member function to call.
+  /// \param object The object, which must outlive the function.
+  ///
+  template <class T, R (T::*Method)(Args...) const>
+  static inplace_function bind(const T& object)
+  {
+    return inplace_function{const_member<T, Method>{&object}};
+  }
+
+private:
+  using storage_t =
+    typename std::aligned_storage<Capacity, Alignment>::type;
+
+  enum class operation { copy, move, destroy };
+
+  using invoke_t = R (*)(void*, Args&&...);
+  using manage_t = void (*)(operation, void*, void*);
+
+  // Whether a callable is stored inline. It has to be nothrow-movable too,
+  // so that moving the function can't throw.
+  template <class Fn>
+  using fits_inline = std::integral_constant<bool,
+    sizeof(Fn) <= Capacity && Alignment % alignof(Fn) == 0 &&
+    std::is_nothrow_move_constructible<Fn>::value>;
+
+  template <class Fn, bool Inline = fits_inline<Fn>::value>
+  struct model
+  {
+    template <class F>
+    static void construct(void* storage, F&& fn)
+    {
+      ::new (storage) Fn(std::forward<F>(fn));
+    }
+
+    static R invoke(void* storage, Args&&... args)
+    {
+      return static_cast<R>(
+        (*static_cast<Fn*>(storage))(std::forward<Args>(args)...));
+    }
+
+    static void manage(operation op, void* destination, void* source)
+    {
+      switch (op)
+      {
+      case operation::copy:
+        ::new (destination) Fn(*static_cast<const Fn*>(source));
+        break;
+      case operation::move:
+        ::new (destination) Fn(std::move(*static_cast<Fn*>(source)));
+        static_cast<Fn*>(source)->~Fn();
+        break;
+      case operation::destroy:
+        static_cast<Fn*>(destination)->~Fn();
+        break;
+      }
+    }
+  };
+
+  // A callable which doesn't fit is allocated, and only the pointer to it is
+  // stored inline.
+  template <class Fn>
+  struct model<Fn, false>
+  {
+    static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                  "callable is over-aligned for this inplace_function");
+
+    template <class F>
+    static void construct(void* storage, F&& fn)
+    {
+      ::new (storage) Fn*(new Fn(std::forward<F>(fn)));
+    }
+
+    static R invoke(void* storage, Args&&... args)
+    {
+      return static_cast<R>(
+        (**static_cast<Fn**>(storage))(std::forward<Args>(args)...));
+    }
+
+    static void manage(operation op, void* destination, void* source)
+    {
+      switch (op)
+      {
+      case operation::copy:
+        ::new (destination) Fn*(new Fn(**static_cast<Fn* const*>(source)));
+        break;
+      case operation::move:
+        ::new (destination) Fn*(*static_cast<Fn**>(source));
+        break;
+      case operation::destroy:
+        delete *static_cast<Fn**>(destination);
+        break;
+      }
+    }
+  };
+
+  template <class T, R (T::*Method)(Args...)>
+  struct member
+  {
+    T* object;
+
+    R operator()(Args... args) const
+    {
+      return (object->*Method)(std::forward<Args>(args)...);
+    }
+  };
+
+  template <class T, R (T::*Method)(Args...) const>
+  struct const_member
+  {
+    const T* object;
+
+    R operator()(Args... args) const
+    {
+      return (object->*Method)(std::forward<Args>(args)...);
+    }
+  };
+
+  static R empty_invoke(void*, Args&&...)
+  {
+    throw std::bad_function_call{};
+  }
+
+  void clear() noexcept
+  {
+    if (manager)
+    {
+      manager(operation::destroy, &storage, nullptr);
+      invoker = &empty_invoke;
+      manager = nullptr;
+    }
+  }
+
+  // The invoker is stored directly rather than in a vtable, so that a call is
+  // a single indirect call.
+  invoke_t invoker = &empty_invoke;
+  manage_t manager = nullptr;
+  storage_t storage;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Signature, std::size_t Capacity, std::size_t Alignment>
+bool operator==(const inplace_function<Signature, Capacity, Alignment>& fn,
+                std::nullptr_t) noexcept
+{
+  return !fn;
+}
+
+template <class Signature, std::size_t Capacity, std::size_t Alignment>
+bool operator!=(const inplace_function<Signature, Capacity, Alignment>& fn,
+                std::nullptr_t) noexcept
+{
+  return static_cast<bool>(fn);
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // INPLACE_FUNCTION_HPP
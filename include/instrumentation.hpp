@@ -0,0 +1,498 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+///
+/// \brief Define this as 1 before including any bb-signals header to collect
+/// metrics for every signal and slot. When it's 0, which is the default, the
+/// instrumentation compiles away entirely.
+///
+#ifndef BB_SIGNALS_INSTRUMENTATION
+#define BB_SIGNALS_INSTRUMENTATION 0
+#endif
+
+///
+/// \brief One in this many slot invocations is timed, along with one in this
+/// many closures submitted to an executor. Must be a power of two.
+///
+#ifndef BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE
+#define BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE 64
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief The metrics collected for a signal.
+///
+struct signal_metrics
+{
+  /// The name given with set_metrics_name(), if any.
+  std::string name;
+  /// The number of emits, including batches.
+  std::uint64_t emits = 0;
+  /// The total number of slots visited by all emits, i.e. the fan-out.
+  std::uint64_t slots_visited = 0;
+  /// The number of disconnected slots which have been removed.
+  std::uint64_t connections_reaped = 0;
+  /// The total time spent acquiring the signal's write lock, to connect,
+  /// compact or close.
+  std::chrono::nanoseconds lock_wait{0};
+};
+
+///
+/// \brief The metrics collected for a slot.
+///
+struct slot_metrics
+{
+  /// The name given with set_metrics_name(), if any.
+  std::string name;
+  /// The number of times the slot has been invoked. A batch delivered by one
+  /// call to emit_batch() counts as a single invocation.
+  std::uint64_t invocations = 0;
+  /// The number of invocations which were timed.
+  std::uint64_t sampled_invocations = 0;
+  /// The total time spent in the timed invocations.
+  std::chrono::nanoseconds sampled_execution{0};
+  /// The number of closures whose time in the executor's queue was timed.
+  std::uint64_t sampled_closures = 0;
+  /// The total time the timed closures spent between being posted and being
+  /// executed.
+  std::chrono::nanoseconds sampled_queue_latency{0};
+};
+
+///
+/// \brief The metrics of every live signal and slot at one point in time.
+///
+struct metrics_snapshot
+{
+  std::vector<signal_metrics> signals;
+  std::vector<slot_metrics> slots;
+};
+
+///
+/// \brief Collect the metrics of every live signal and slot. Returns empty
+/// lists unless BB_SIGNALS_INSTRUMENTATION is enabled.
+///
+metrics_snapshot snapshot_metrics();
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+#if BB_SIGNALS_INSTRUMENTATION
+
+///
+/// \brief A set of counters which are sharded between threads, so that
+/// threads which update the same counters rarely touch the same cache line.
+/// Each thread always uses the same shard.
+///
+template <std::size_t Count>
+class sharded_counters
+{
+public:
+  void add(std::size_t counter, std::uint64_t value)
+  {
+    shards[shard_index()].values[counter].fetch_add(
+      value, std::memory_order_relaxed);
+  }
+
+  std::uint64_t sum(std::size_t counter) const
+  {
+    std::uint64_t total = 0;
+    for (const shard& s : shards)
+      total += s.values[counter].load(std::memory_order_relaxed);
+    return total;
+  }
+
+private:
+  static constexpr std::size_t shard_count = 8;
+
+  struct shard
+  {
+    std::atomic<std::uint64_t> values[Count] = {};
+
+    // Keep each shard's counters off its neighbours' cache lines.
+    char padding[64];
+  };
+
+  static std::size_t shard_index()
+  {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t index =
+      next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+    return index;
+  }
+
+  shard shards[shard_count];
+};
+
+///
+/// \brief Whether the calling thread should time this event.
+///
+inline bool sample()
+{
+  static_assert((BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE &
+                 (BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE - 1)) == 0,
+                "the instrumentation sample rate must be a power of two");
+
+  thread_local unsigned tick = 0;
+  return (++tick & (BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE - 1)) == 0;
+}
+
+using instrumentation_clock = std::chrono::steady_clock;
+
+inline std::uint64_t elapsed_ns(instrumentation_clock::time_point start)
+{
+  return static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      instrumentation_clock::now() - start).count());
+}
+
+///
+/// \brief The base of every instrumented object. Objects register themselves
+/// for their whole lifetime, so that a snapshot can find them.
+/// \note A snapshot calls report() on every registered object, so the final
+/// class must enroll() at the end of its constructor and withdraw() at the
+/// start of its destructor, while it is still complete.
+///
+class instrumented
+{
+public:
+  instrumented() = default;
+  instrumented(const instrumented&) = delete;
+  instrumented& operator=(const instrumented&) = delete;
+
+  void set_name(std::string name);
+
+  virtual void report(metrics_snapshot& snapshot) const = 0;
+
+protected:
+  ~instrumented() = default;
+
+  void enroll() const;
+  void withdraw() const;
+
+  // Must only be read by report().
+  std::string name;
+};
+
+///
+/// \brief The registry of every live instrumented object.
+///
+class metrics_registry
+{
+public:
+  static metrics_registry& instance()
+  {
+    static metrics_registry registry;
+    return registry;
+  }
+
+  void add(const instrumented* object)
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    objects.push_back(object);
+  }
+
+  void remove(const instrumented* object)
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    for (auto& o : objects)
+    {
+      if (o == object)
+      {
+        o = objects.back();
+        objects.pop_back();
+        return;
+      }
+    }
+  }
+
+  template <class Fn>
+  void locked(Fn&& fn)
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    fn();
+  }
+
+  metrics_snapshot snapshot()
+  {
+    metrics_snapshot result;
+    std::unique_lock<std::mutex> lock{mutex};
+    for (const instrumented* object : objects)
+      object->report(result);
+    return result;
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<const instrumented*> objects;
+};
+
+inline void instrumented::enroll() const
+{
+  metrics_registry::instance().add(this);
+}
+
+inline void instrumented::withdraw() const
+{
+  metrics_registry::instance().remove(this);
+}
+
+inline void instrumented::set_name(std::string new_name)
+{
+  metrics_registry::instance().locked([&]{ name = std::move(new_name); });
+}
+
+///
+/// \brief The metrics of a signal.
+///
+class signal_stats final : public instrumented
+{
+public:
+  signal_stats()
+  {
+    enroll();
+  }
+
+  ~signal_stats()
+  {
+    withdraw();
+  }
+
+  void emitted(std::size_t slots_visited)
+  {
+    counters.add(emits, 1);
+    counters.add(visited, slots_visited);
+  }
+
+  void reaped(std::size_t count)
+  {
+    if (count != 0)
+      counters.add(reaped_connections, count);
+  }
+
+  template <class Lock>
+  void lock(Lock& lock)
+  {
+    auto start = instrumentation_clock::now();
+    lock.lock();
+    counters.add(lock_wait_ns, elapsed_ns(start));
+  }
+
+  template <class Lock>
+  bool try_lock(Lock& lock)
+  {
+    auto start = instrumentation_clock::now();
+    bool locked = lock.try_lock();
+    counters.add(lock_wait_ns, elapsed_ns(start));
+    return locked;
+  }
+
+  void report(metrics_snapshot& snapshot) const override
+  {
+    signal_metrics metrics;
+    metrics.name = name;
+    metrics.emits = counters.sum(emits);
+    metrics.slots_visited = counters.sum(visited);
+    metrics.connections_reaped = counters.sum(reaped_connections);
+    metrics.lock_wait = std::chrono::nanoseconds{
+      static_cast<std::chrono::nanoseconds::rep>(counters.sum(lock_wait_ns))};
+    snapshot.signals.push_back(std::move(metrics));
+  }
+
+private:
+  enum counter : std::size_t
+  {
+    emits,
+    visited,
+    reaped_connections,
+    lock_wait_ns,
+    counter_count
+  };
+
+  sharded_counters<counter_count> counters;
+};
+
+///
+/// \brief The metrics of a slot.
+///
+class slot_stats final : public instrumented
+{
+public:
+  slot_stats()
+  {
+    enroll();
+  }
+
+  ~slot_stats()
+  {
+    withdraw();
+  }
+
+  ///
+  /// \brief Times an invocation of the slot's function, if it's sampled.
+  ///
+  class invocation_timer
+  {
+  public:
+    explicit invocation_timer(slot_stats& stats)
+      : stats(stats)
+      , sampled(sample())
+    {
+      if (sampled)
+        start = instrumentation_clock::now();
+    }
+
+    invocation_timer(const invocation_timer&) = delete;
+    invocation_timer& operator=(const invocation_timer&) = delete;
+
+    ~invocation_timer()
+    {
+      stats.counters.add(invocations, 1);
+      if (sampled)
+      {
+        stats.counters.add(sampled_invocations, 1);
+        stats.counters.add(execution_ns, elapsed_ns(start));
+      }
+    }
+
+  private:
+    slot_stats& stats;
+    bool sampled;
+    instrumentation_clock::time_point start;
+  };
+
+  ///
+  /// \brief Records when a closure was submitted to an executor, if it's
+  /// sampled.
+  ///
+  using ticket = instrumentation_clock::time_point;
+
+  ticket enqueued()
+  {
+    return sample() ? instrumentation_clock::now() : ticket{};
+  }
+
+  void dequeued(ticket submitted)
+  {
+    if (submitted == ticket{})
+      return;
+
+    counters.add(sampled_closures, 1);
+    counters.add(queue_latency_ns, elapsed_ns(submitted));
+  }
+
+  void report(metrics_snapshot& snapshot) const override
+  {
+    slot_metrics metrics;
+    metrics.name = name;
+    metrics.invocations = counters.sum(invocations);
+    metrics.sampled_invocations = counters.sum(sampled_invocations);
+    metrics.sampled_execution = to_duration(counters.sum(execution_ns));
+    metrics.sampled_closures = counters.sum(sampled_closures);
+    metrics.sampled_queue_latency =
+      to_duration(counters.sum(queue_latency_ns));
+    snapshot.slots.push_back(std::move(metrics));
+  }
+
+private:
+  enum counter : std::size_t
+  {
+    invocations,
+    sampled_invocations,
+    execution_ns,
+    sampled_closures,
+    queue_latency_ns,
+    counter_count
+  };
+
+  static std::chrono::nanoseconds to_duration(std::uint64_t ns)
+  {
+    return std::chrono::nanoseconds{
+      static_cast<std::chrono::nanoseconds::rep>(ns)};
+  }
+
+  sharded_counters<counter_count> counters;
+};
+
+#else
+
+// Instrumentation is disabled, so every hook does nothing.
+
+class signal_stats
+{
+public:
+  void set_name(std::string) { }
+  void emitted(std::size_t) { }
+  void reaped(std::size_t) { }
+
+  template <class Lock>
+  void lock(Lock& lock)
+  {
+    lock.lock();
+  }
+
+  template <class Lock>
+  bool try_lock(Lock& lock)
+  {
+    return lock.try_lock();
+  }
+};
+
+class slot_stats
+{
+public:
+  class invocation_timer
+  {
+  public:
+    explicit invocation_timer(slot_stats&)
+    { }
+  };
+
+  struct ticket
+  { };
+
+  void set_name(std::string) { }
+  ticket enqueued() { return {}; }
+  void dequeued(ticket) { }
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+inline metrics_snapshot snapshot_metrics()
+{
+#if BB_SIGNALS_INSTRUMENTATION
+  return detail::metrics_registry::instance().snapshot();
+#else
+  return metrics_snapshot{};
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,255 @@
+#ifndef MEMORY_RESOURCE_HPP
+#define MEMORY_RESOURCE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+#if __cplusplus >= 201703L
+
+///
+/// \brief The interface for memory resources from which signal, slot and
+/// connection state can be allocated. From C++17 this is
+/// std::pmr::memory_resource, so any standard resource can be used.
+///
+using memory_resource = std::pmr::memory_resource;
+
+///
+/// \brief The resource used when none is given, which uses the global
+/// operator new and operator delete.
+///
+inline memory_resource* new_delete_resource() noexcept
+{
+  return std::pmr::new_delete_resource();
+}
+
+#else
+
+///
+/// \brief The interface for memory resources from which signal, slot and
+/// connection state can be allocated. It has the same interface as C++17's
+/// std::pmr::memory_resource, which it is an alias for from C++17.
+///
+class memory_resource
+{
+public:
+  virtual ~memory_resource() = default;
+
+  void* allocate(std::size_t bytes,
+                 std::size_t alignment = alignof(std::max_align_t))
+  {
+    return do_allocate(bytes, alignment);
+  }
+
+  void deallocate(void* p, std::size_t bytes,
+                  std::size_t alignment = alignof(std::max_align_t))
+  {
+    do_deallocate(p, bytes, alignment);
+  }
+
+  bool is_equal(const memory_resource& other) const noexcept
+  {
+    return do_is_equal(other);
+  }
+
+private:
+  virtual void* do_allocate(std::size_t bytes, std::size_t alignment) = 0;
+  virtual void do_deallocate(void* p, std::size_t bytes,
+                             std::size_t alignment) = 0;
+  virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+};
+
+namespace detail {
+
+class new_delete_resource_t final : public memory_resource
+{
+private:
+  void* do_allocate(std::size_t bytes, std::size_t) override
+  {
+    return ::operator new(bytes);
+  }
+
+  void do_deallocate(void* p, std::size_t, std::size_t) override
+  {
+    ::operator delete(p);
+  }
+
+  bool do_is_equal(const memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+}
+
+///
+/// \brief The resource used when none is given, which uses the global
+/// operator new and operator delete.
+///
+inline memory_resource* new_delete_resource() noexcept
+{
+  static detail::new_delete_resource_t resource;
+  return &resource;
+}
+
+#endif
+
+///
+/// \brief A minimal allocator which allocates from a memory resource, for the
+/// containers and shared states inside signals and slots.
+/// \tparam T The allocated type.
+///
+template <class T>
+class resource_allocator
+{
+public:
+  using value_type = T;
+
+  ///
+  /// \brief Construct an allocator which uses new_delete_resource().
+  ///
+  resource_allocator() noexcept
+    : memory(new_delete_resource())
+  { }
+
+  ///
+  /// \brief Construct an allocator which uses the given resource, which must
+  /// outlive everything allocated from it.
+  ///
+  resource_allocator(memory_resource* memory) noexcept
+    : memory(memory)
+  { }
+
+  template <class U>
+  resource_allocator(const resource_allocator<U>& other) noexcept
+    : memory(other.resource())
+  { }
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(memory->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    memory->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  memory_resource* resource() const noexcept
+  {
+    return memory;
+  }
+
+private:
+  memory_resource* memory;
+};
+
+template <class T, class U>
+bool operator==(const resource_allocator<T>& a,
+                const resource_allocator<U>& b) noexcept
+{
+  return a.resource() == b.resource() || a.resource()->is_equal(*b.resource());
+}
+
+template <class T, class U>
+bool operator!=(const resource_allocator<T>& a,
+                const resource_allocator<U>& b) noexcept
+{
+  return !(a == b);
+}
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Destroys and deallocates an object which was allocated from a
+/// memory resource.
+///
+template <class T>
+struct resource_deleter
+{
+  explicit resource_deleter(memory_resource* memory) noexcept
+    : memory(memory)
+  { }
+
+  template <class U,
+            class = typename std::enable_if<
+              std::is_convertible<U*, T*>::value>::type>
+  resource_deleter(const resource_deleter<U>& other) noexcept
+    : memory(other.memory)
+  { }
+
+  memory_resource* memory;
+
+  void operator()(T* p) const
+  {
+    p->~T();
+    memory->deallocate(const_cast<void*>(static_cast<const void*>(p)),
+                       sizeof(T), alignof(T));
+  }
+};
+
+template <class T>
+using resource_ptr = std::unique_ptr<T, resource_deleter<T>>;
+
+///
+/// \brief Allocate and construct an object from a memory resource.
+///
+template <class T, class... Args>
+resource_ptr<T> make_resource_ptr(memory_resource* memory, Args&&... args)
+{
+  void* p = memory->allocate(sizeof(T), alignof(T));
+  try
+  {
+    return resource_ptr<T>{::new (p) T(std::forward<Args>(args)...),
+                           resource_deleter<T>{memory}};
+  }
+  catch (...)
+  {
+    memory->deallocate(p, sizeof(T), alignof(T));
+    throw;
+  }
+}
+
+///
+/// \brief The resource which an allocator allocates from: the allocator's own
+/// resource, or new_delete_resource() for std::allocator.
+///
+template <class T>
+memory_resource* resource_of(const std::allocator<T>&) noexcept
+{
+  return new_delete_resource();
+}
+
+template <class T>
+memory_resource* resource_of(const resource_allocator<T>& alloc) noexcept
+{
+  return alloc.resource();
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // MEMORY_RESOURCE_HPP
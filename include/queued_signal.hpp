@@ -0,0 +1,324 @@
+#ifndef QUEUED_SIGNAL_HPP
+#define QUEUED_SIGNAL_HPP
+
+#include "batch.hpp"
+#include "emitter.hpp"
+#include "signal.hpp"
+#include "slot.hpp"
+#include "tags.hpp"
+#include "threading.hpp"
+#include "detail/mpmc_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A signal which is emitted from any thread and dispatched on the
+/// thread which owns it.
+///
+/// Each emit pushes its arguments once, as a tuple, into a lock-free ring,
+/// however many slots there are. The owning thread drains the ring with
+/// poll() or run() and emits what it finds to its local slots as one batch,
+/// so slots are invoked on that thread without a closure being allocated and
+/// submitted for each of them, as it would be with an executor.
+///
+/// \code
+/// bb::queued_signal<int> queued;
+/// bb::basic_slot<bb::single_threaded, int> slot{[](int value){ ... }};
+/// bb::connect(queued.signal(), slot);
+///
+/// bb::emitter<int> emitter;
+/// bb::connect(emitter, queued);
+/// emitter(1);     // on any thread
+/// queued.poll();  // on the owning thread, which invokes the slot
+/// \endcode
+///
+/// \tparam Params... The signal parameters.
+///
+template <class... Params>
+class queued_signal
+{
+public:
+  ///
+  /// \brief The signal to which the owning thread's slots connect. Its slots
+  /// are only ever invoked from poll() and run(), so it's single_threaded.
+  ///
+  using local_signal_t = basic_signal<single_threaded, Params...>;
+
+  ///
+  /// \brief The type of slot which can connect to the local signal.
+  ///
+  using slot_t = basic_slot<single_threaded, Params...>;
+
+  ///
+  /// \brief Construct a queued signal.
+  /// \param options The capacity of the ring, which is at least one, and
+  /// what an emit does when it's full. An emit which blocks waits for the
+  /// owning thread to poll, so the owning thread mustn't emit to a full
+  /// blocking signal itself.
+  ///
+  explicit queued_signal(bounded_t options = bounded(1024));
+
+  ///
+  /// \brief Deleted copy constructor.
+  ///
+  queued_signal(const queued_signal&) = delete;
+
+  ///
+  /// \brief Deleted copy assignment operator.
+  ///
+  queued_signal& operator=(const queued_signal&) = delete;
+
+  ///
+  /// \brief Disconnect the emitters, waiting for any emits in progress, and
+  /// drop any events which haven't been dispatched. Emits blocked on a full
+  /// ring give up.
+  ///
+  ~queued_signal();
+
+  ///
+  /// \brief The signal to which the owning thread's slots connect.
+  ///
+  const local_signal_t& signal() const;
+
+  ///
+  /// \brief Dispatch the events which have been queued so far to the local
+  /// slots, as a single batch. At most a ring's worth of events is dispatched,
+  /// so that a flood of emits can't keep the owning thread here forever.
+  /// \return The number of events dispatched.
+  /// \note Must only be called from the owning thread.
+  ///
+  std::size_t poll();
+
+  ///
+  /// \brief Dispatch events as they're queued, sleeping while there are none,
+  /// until stop() is called, and then dispatch what's still queued, as one
+  /// more poll() would, before returning. If stop() is called while run()
+  /// isn't running, the next call only does the final dispatch.
+  /// \note Must only be called from the owning thread.
+  ///
+  void run();
+
+  ///
+  /// \brief Make run() return. May be called from any thread, including from
+  /// a local slot.
+  ///
+  void stop();
+
+  ///
+  /// \brief The number of emits which found the ring full.
+  ///
+  std::size_t overflow_count() const;
+
+  ///
+  /// \brief Connect an emitter to a queued signal, so that calling the
+  /// emitter queues an event for the owning thread.
+  /// \param emitter The sending emitter, whose existing connections are
+  /// destroyed.
+  /// \param signal The receiving signal. Any number of emitters may be
+  /// connected to it, each from its own thread.
+  ///
+  template <class... T>
+  friend void connect(basic_emitter<multi_threaded, T...>& emitter,
+                      queued_signal<T...>& signal);
+
+  ///
+  /// \brief Join an emitter to a queued signal, keeping the emitter's
+  /// existing connections.
+  ///
+  template <class... T>
+  friend void connect(basic_emitter<multi_threaded, T...>& emitter,
+                      queued_signal<T...>& signal, join_t);
+
+private:
+  using event_t = typename batch<Params...>::value_type;
+  using events_t = std::vector<event_t>;
+
+  void push(event_t event);
+
+  detail::mpmc_queue<event_t> events;
+  const overflow policy;
+  std::atomic<std::size_t> overflows{0};
+  std::atomic<bool> closed{false};
+
+  // Wakes run() when an event is pushed while it's asleep.
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> stopping{false};
+
+  // The buffer into which poll() drains the ring, which keeps its capacity
+  // from one poll to the next.
+  events_t drained;
+
+  basic_emitter<single_threaded, Params...> local_emitter;
+  local_signal_t local;
+
+  // The signal which emitters join, and the one slot connected to it, which
+  // pushes each emit into the ring. The slot is destroyed first, so no emit
+  // can reach the ring once destruction has begun.
+  basic_signal<multi_threaded, Params...> input;
+  basic_slot<multi_threaded, Params...> relay;
+};
+
+//------------------------------------------------------------------------------
+
+template <class... Params>
+queued_signal<Params...>::queued_signal(bounded_t options)
+  : events(options.capacity)
+  , policy(options.policy)
+  , relay{reentrant, [this](auto&&... args)
+      {
+        push(event_t{std::forward<decltype(args)>(args)...});
+      }}
+{
+  connect(local_emitter, local);
+
+  // Joining gives the input a state, which it keeps however many emitters
+  // are connected and disconnected.
+  basic_emitter<multi_threaded, Params...> seed;
+  connect(seed, input, join);
+  connect(input, relay);
+}
+
+template <class... Params>
+queued_signal<Params...>::~queued_signal()
+{
+  closed.store(true, std::memory_order_relaxed);
+}
+
+template <class... Params>
+auto queued_signal<Params...>::signal() const -> const local_signal_t&
+{
+  return local;
+}
+
+template <class... Params>
+std::size_t queued_signal<Params...>::poll()
+{
+  // A local slot which polls again drains into a buffer of its own, rather
+  // than the one being dispatched.
+  events_t batch = std::move(drained);
+
+  std::size_t limit = events.capacity();
+  while (limit-- != 0 &&
+         events.try_consume([&batch](event_t&& event)
+         {
+           batch.push_back(std::move(event));
+         }))
+  { }
+
+  std::size_t count = batch.size();
+  if (count != 0)
+    local_emitter.emit_batch(batch);
+
+  batch.clear();
+  drained = std::move(batch);
+  return count;
+}
+
+template <class... Params>
+void queued_signal<Params...>::run()
+{
+  while (!stopping.exchange(false, std::memory_order_relaxed))
+  {
+    if (poll() != 0)
+      continue;
+
+    // An emit pushes before it checks whether run() is asleep, and run()
+    // says it's asleep before it checks the ring, so one of them sees the
+    // other and no wake up is lost.
+    std::unique_lock<std::mutex> lock{mutex};
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake.wait(lock, [this]
+    {
+      return stopping.load(std::memory_order_relaxed) || !events.empty();
+    });
+    sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  poll();
+}
+
+template <class... Params>
+void queued_signal<Params...>::stop()
+{
+  stopping.store(true, std::memory_order_relaxed);
+  std::unique_lock<std::mutex> lock{mutex};
+  wake.notify_one();
+}
+
+template <class... Params>
+std::size_t queued_signal<Params...>::overflow_count() const
+{
+  return overflows.load(std::memory_order_relaxed);
+}
+
+template <class... Params>
+void queued_signal<Params...>::push(event_t event)
+{
+  if (!events.try_push(std::move(event)))
+  {
+    overflows.fetch_add(1, std::memory_order_relaxed);
+
+    switch (policy)
+    {
+    case overflow::block:
+      while (!events.try_push(std::move(event)))
+      {
+        if (closed.load(std::memory_order_relaxed))
+          return;
+        std::this_thread::yield();
+      }
+      break;
+    case overflow::drop_newest:
+      return;
+    case overflow::drop_oldest:
+      while (!events.try_push(std::move(event)))
+        events.try_consume([](event_t&&){ });
+      break;
+    }
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping.load(std::memory_order_relaxed))
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    wake.notify_one();
+  }
+}
+
+template <class... Params>
+void connect(basic_emitter<multi_threaded, Params...>& emitter,
+             queued_signal<Params...>& signal)
+{
+  emitter = basic_emitter<multi_threaded, Params...>{};
+  connect(emitter, signal.input, join);
+}
+
+template <class... Params>
+void connect(basic_emitter<multi_threaded, Params...>& emitter,
+             queued_signal<Params...>& signal, join_t)
+{
+  connect(emitter, signal.input, join);
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // QUEUED_SIGNAL_HPP
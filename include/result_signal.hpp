@@ -0,0 +1,275 @@
+#ifndef RESULT_SIGNAL_HPP
+#define RESULT_SIGNAL_HPP
+
+#include "combiners.hpp"
+#include "connection.hpp"
+#include "emitter.hpp"
+#include "memory_resource.hpp"
+#include "signal.hpp"
+#include "slot.hpp"
+#include "tags.hpp"
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Passes each slot's result to the combiner of the emit in progress.
+///
+/// A result signal is built on an ordinary signal with a pointer to this as an
+/// extra, final parameter, and each slot is a short-circuiting slot which
+/// pushes its result into the sink, so the results are combined within the
+/// emit without being stored anywhere in between.
+///
+template <class R>
+class result_sink
+{
+public:
+  template <class Combiner>
+  explicit result_sink(Combiner& combiner)
+    : combiner(&combiner)
+    , push_fn(&push_to<Combiner>)
+  { }
+
+  ///
+  /// \brief Pass a result to the combiner.
+  /// \return Whether the emit should continue.
+  ///
+  bool push(R result) const
+  {
+    return push_fn(combiner, std::move(result));
+  }
+
+private:
+  template <class Combiner>
+  static bool push_to(void* combiner, R result)
+  {
+    return (*static_cast<Combiner*>(combiner))(std::move(result));
+  }
+
+  void* combiner;
+  bool (*push_fn)(void*, R);
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief A signal whose slots return results, which are combined by each
+/// emit. Slots with a higher priority are invoked, and so combined, first.
+/// \tparam Policy The threading policy: multi_threaded or single_threaded.
+/// \tparam R The result type of the slots.
+/// \tparam Args... The signal parameters.
+///
+template <class Policy, class R, class... Args>
+class basic_signal<Policy, R(Args...)>
+{
+public:
+  static_assert(!std::is_void<R>::value,
+                "signals with a void result take their parameters directly");
+
+  ///
+  /// \brief Name the signal in the metrics returned by snapshot_metrics().
+  ///
+  void set_metrics_name(std::string name)
+  {
+    signal.set_metrics_name(std::move(name));
+  }
+
+  template <class P, class Q, class... A>
+  friend void connect(basic_emitter<P, Q(A...)>& emitter,
+                      basic_signal<P, Q(A...)>& signal);
+
+  template <class P, class Q, class... A>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, Q(A...)>& emitter,
+                      basic_signal<P, Q(A...)>& signal);
+
+  template <class P, class Q, class... A>
+  friend void connect(const basic_signal<P, Q(A...)>& signal,
+                      basic_slot<P, Q(A...)>& slot, priority p);
+
+  template <class Fn, class P, class Q, class... A>
+  friend connection connect(const basic_signal<P, Q(A...)>& signal, Fn fn,
+                            priority p);
+
+private:
+  basic_signal<Policy, Args..., const detail::result_sink<R>*> signal;
+};
+
+///
+/// \brief A slot for a signal whose slots return results. Result slots are
+/// always invoked on the emitting thread, so that their results can be
+/// combined.
+///
+template <class Policy, class R, class... Args>
+class basic_slot<Policy, R(Args...)>
+{
+public:
+  ///
+  /// \brief Construct an empty slot.
+  ///
+  basic_slot() = default;
+
+  ///
+  /// \brief Construct a slot which will call the given function when a signal
+  /// is received, and pass its result to the emit's combiner.
+  /// \param fn A function which takes the signal parameters and returns R.
+  ///
+  template <class Fn,
+            class = typename std::enable_if<
+              !std::is_same<typename std::decay<Fn>::type,
+                            basic_slot>::value>::type>
+  basic_slot(Fn fn)
+    : slot{short_circuit, handler(std::move(fn))}
+  { }
+
+  ///
+  /// \brief Construct a slot whose state is allocated from the given memory
+  /// resource, which must outlive it.
+  ///
+  template <class Fn>
+  basic_slot(std::allocator_arg_t, memory_resource& resource, Fn fn)
+    : slot{std::allocator_arg, resource, short_circuit,
+           handler(std::move(fn))}
+  { }
+
+  ///
+  /// \brief Name the slot in the metrics returned by snapshot_metrics().
+  ///
+  void set_metrics_name(std::string name)
+  {
+    slot.set_metrics_name(std::move(name));
+  }
+
+  template <class P, class Q, class... A>
+  friend void connect(const basic_signal<P, Q(A...)>& signal,
+                      basic_slot<P, Q(A...)>& slot, priority p);
+
+  template <class Fn, class P, class Q, class... A>
+  friend connection connect(const basic_signal<P, Q(A...)>& signal, Fn fn,
+                            priority p);
+
+private:
+  // Wrap a function so that it pushes its result, and stops the emit if the
+  // combiner says so.
+  template <class Fn>
+  static auto handler(Fn fn)
+  {
+    return [fn = std::move(fn)](Args... args,
+                                const detail::result_sink<R>* sink) mutable
+    {
+      return !sink->push(fn(std::forward<Args>(args)...));
+    };
+  }
+
+  basic_slot<Policy, Args..., const detail::result_sink<R>*> slot;
+};
+
+///
+/// \brief An emitter for a signal whose slots return results.
+///
+template <class Policy, class R, class... Args>
+class basic_emitter<Policy, R(Args...)>
+{
+public:
+  ///
+  /// \brief Emit the signal and combine the results of the slots.
+  /// \param combiner A combiner, such as one of those in bb::combiners, which
+  /// receives each result in turn and can stop the emit early.
+  /// \param args The arguments with which to emit the signal.
+  /// \return The combined result, or the combiner's initial result if the
+  /// emitter isn't connected or no slots were invoked.
+  ///
+  template <class Combiner, class... A>
+  typename Combiner::result_type combine(Combiner combiner, A&&... args)
+  {
+    detail::result_sink<R> sink{combiner};
+    emitter(std::forward<A>(args)..., &sink);
+    return combiner.result();
+  }
+
+  ///
+  /// \brief Pin the state of the emitter's signal, as for basic_emitter.
+  ///
+  void pin()
+  {
+    emitter.pin();
+  }
+
+  template <class P, class Q, class... A>
+  friend void connect(basic_emitter<P, Q(A...)>& emitter,
+                      basic_signal<P, Q(A...)>& signal);
+
+  template <class P, class Q, class... A>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, Q(A...)>& emitter,
+                      basic_signal<P, Q(A...)>& signal);
+
+private:
+  basic_emitter<Policy, Args..., const detail::result_sink<R>*> emitter;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Policy, class R, class... Args>
+void connect(basic_emitter<Policy, R(Args...)>& emitter,
+             basic_signal<Policy, R(Args...)>& signal)
+{
+  connect(emitter.emitter, signal.signal);
+}
+
+template <class Policy, class R, class... Args>
+void connect(std::allocator_arg_t, memory_resource& resource,
+             basic_emitter<Policy, R(Args...)>& emitter,
+             basic_signal<Policy, R(Args...)>& signal)
+{
+  connect(std::allocator_arg, resource, emitter.emitter, signal.signal);
+}
+
+template <class Policy, class R, class... Args>
+void connect(const basic_signal<Policy, R(Args...)>& signal,
+             basic_slot<Policy, R(Args...)>& slot, priority p)
+{
+  connect(signal.signal, slot.slot, p);
+}
+
+template <class Fn, class Policy, class R, class... Args>
+connection connect(const basic_signal<Policy, R(Args...)>& signal, Fn fn,
+                   priority p)
+{
+  using slot_t = basic_slot<Policy, R(Args...)>;
+  using state_t = detail::signal_state<Policy, Args...,
+                                       const detail::result_sink<R>*>;
+  using handler_function_t = typename state_t::handler_function_t;
+
+  auto& state = detail::signal_access::state(signal.signal);
+  if (!state)
+    return connection{};
+
+  return detail::signal_access::make_connection(
+    state->connect(handler_function_t{slot_t::handler(std::move(fn))},
+                   p.value));
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // RESULT_SIGNAL_HPP
@@ -1,12 +1,17 @@
 #ifndef SIGNAL_HPP
 #define SIGNAL_HPP
 
+#include "connection.hpp"
 #include "detail/signal_state.hpp"
+#include "inplace_function.hpp"
+#include "memory_resource.hpp"
 #include "slot.hpp"
+#include "tags.hpp"
+#include "threading.hpp"
 
-#include <functional>
 #include <list>
 #include <memory>
+#include <string>
 
 //------------------------------------------------------------------------------
 
@@ -14,47 +19,65 @@ namespace bb {
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-class emitter;
+template <class Policy, class... Params>
+class basic_emitter;
+
+namespace detail {
+struct signal_access;
+}
 
 ///
 /// \brief The signal class represents a signal to which client can connect
 /// functions which receive the signals when they are emitted.
+/// \tparam Policy The threading policy: multi_threaded or single_threaded.
 /// \tparam Params... The signal parameters.
 ///
-template <class... Params>
-class signal
+template <class Policy, class... Params>
+class basic_signal
 {
 public:
   ///
   /// \brief The function type which can connect to this type of signal.
   ///
-  using function_t = std::function<void(Params...)>;
+  using function_t = inplace_function<void(Params...)>;
 
   ///
   /// \brief Construct an inactive signal.
   ///
-  signal();
+  basic_signal();
 
   ///
   /// \brief Deleted copy constructor.
   ///
-  signal(const signal&) = delete;
+  basic_signal(const basic_signal&) = delete;
 
   ///
   /// \brief Deleted copy assignment operator.
   ///
-  auto operator=(const signal&) -> signal& = delete;
+  auto operator=(const basic_signal&) -> basic_signal& = delete;
 
   ///
   /// \brief Move constructor.
   ///
-  signal(signal&&);
+  basic_signal(basic_signal&&);
 
   ///
-  /// \brief Move assignment operator.
+  /// \brief Move assignment operator. The signal's existing state is closed
+  /// first, as if the signal had been destroyed.
   ///
-  auto operator=(signal&&) -> signal&;
+  auto operator=(basic_signal&&) -> basic_signal&;
+
+  ///
+  /// \brief The destructor releases the signal's connections, and emitters
+  /// stop emitting to it.
+  ///
+  ~basic_signal();
+
+  ///
+  /// \brief Name the signal in the metrics returned by snapshot_metrics().
+  /// Does nothing unless BB_SIGNALS_INSTRUMENTATION is enabled.
+  ///
+  void set_metrics_name(std::string name);
 
   ///
   /// \brief Connect an existing signal to an existing slot so that the slot is
@@ -62,63 +85,179 @@ public:
   /// \param signal A const reference to an existing signal to listen to.
   /// \param slot A reference to an existing slot to receive signals.
   ///
-  template <class... T>
-  friend void connect(const signal<T...>& signal, slot<T...>& slot);
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot);
+
+  ///
+  /// \brief Connect an existing signal to an existing slot with a priority.
+  /// Slots with a higher priority are invoked first, and slots with equal
+  /// priority in the order they were connected.
+  /// \param signal A const reference to an existing signal to listen to.
+  /// \param slot A reference to an existing slot to receive signals.
+  /// \param p The priority of the connection.
+  ///
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot, priority p);
 
   ///
   /// \brief Connect an existing signal to a function so that the function is
   /// called when the signal is emitted.
   /// \param signal A const reference to an existing signal to listen to.
   /// \param fn A function to receive signals.
+  /// \return A handle with which to disconnect the function.
   ///
-  template <class Fn, class... T>
-  friend void connect(const signal<T...>& signal, Fn fn);
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn);
+
+  ///
+  /// \brief Connect an existing signal to a function with a priority.
+  /// \param signal A const reference to an existing signal to listen to.
+  /// \param fn A function to receive signals.
+  /// \param p The priority of the connection.
+  /// \return A handle with which to disconnect the function.
+  ///
+  template <class Fn, class P, class... T>
+  friend connection connect(const basic_signal<P, T...>& signal, Fn fn,
+                            priority p);
 
 private:
-  template <class... T>
-  friend void connect(emitter<T...>& emitter, signal<T...>& signal);
+  template <class P, class... T>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal);
+
+  template <class P, class... T>
+  friend void connect(basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal, join_t);
+
+  template <class P, class... T>
+  friend void connect(std::allocator_arg_t, memory_resource& resource,
+                      basic_emitter<P, T...>& emitter,
+                      basic_signal<P, T...>& signal, join_t);
+
+  friend struct detail::signal_access;
 
-  using state_t = detail::signal_state<Params...>;
+  using state_t = detail::signal_state<Policy, Params...>;
   using shared_state_t = std::shared_ptr<state_t>;
 
-  signal(shared_state_t);
+  basic_signal(shared_state_t);
 
   shared_state_t state;
 };
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-signal<Params...>::signal(shared_state_t state)
+namespace detail {
+
+///
+/// \brief Gives adaptors which are built on signals, such as the coroutine
+/// adaptors, access to a signal's state.
+///
+struct signal_access
+{
+  template <class Policy, class... Params>
+  static const std::shared_ptr<signal_state<Policy, Params...>>&
+  state(const basic_signal<Policy, Params...>& signal)
+  {
+    return signal.state;
+  }
+
+  ///
+  /// \brief Make a handle to a connection made through a signal's state.
+  ///
+  static connection make_connection(std::weak_ptr<connection_state> state)
+  {
+    return connection{std::move(state)};
+  }
+};
+
+}
+
+//------------------------------------------------------------------------------
+
+template <class Policy, class... Params>
+basic_signal<Policy, Params...>::basic_signal(shared_state_t state)
   : state{std::move(state)}
 {
 }
 
-template <class... Params>
-signal<Params...>::signal() = default;
+template <class Policy, class... Params>
+basic_signal<Policy, Params...>::basic_signal() = default;
 
-template <class... Params>
-signal<Params...>::signal(signal&&) = default;
+template <class Policy, class... Params>
+basic_signal<Policy, Params...>::basic_signal(basic_signal&&) = default;
 
-template <class... Params>
-signal<Params...>& signal<Params...>::operator=(signal&&) = default;
+template <class Policy, class... Params>
+basic_signal<Policy, Params...>&
+basic_signal<Policy, Params...>::operator=(basic_signal&& other)
+{
+  if (this != &other)
+  {
+    if (state) state->close();
+    detail::visit_scope::release(state);
+    state = std::move(other.state);
+  }
+  return *this;
+}
 
-template <class... Params>
-void connect(const signal<Params...>& signal, slot<Params...>& slot)
+template <class Policy, class... Params>
+basic_signal<Policy, Params...>::~basic_signal()
 {
-  if (signal.state)
-    signal.state->connect(slot.state);
+  // Pinned emitters share ownership of the state, so it has to be closed
+  // explicitly rather than by being destroyed. A slot may be destroying the
+  // signal during an emit, which then keeps the state until it's finished.
+  if (state) state->close();
+  detail::visit_scope::release(state);
 }
 
-template <class Fn, class... Params>
-void connect(const signal<Params...>& signal, Fn fn)
+template <class Policy, class... Params>
+void basic_signal<Policy, Params...>::set_metrics_name(std::string name)
 {
-  using function_t = typename signal<Params...>::function_t;
-  if (signal.state)
-    signal.state->connect(function_t{std::move(fn)});
+  if (state)
+    state->set_metrics_name(std::move(name));
+}
 
+template <class Policy, class... Params>
+void connect(const basic_signal<Policy, Params...>& signal,
+             basic_slot<Policy, Params...>& slot)
+{
+  connect(signal, slot, priority{0});
 }
 
+template <class Policy, class... Params>
+void connect(const basic_signal<Policy, Params...>& signal,
+             basic_slot<Policy, Params...>& slot, priority p)
+{
+  if (signal.state && slot.state)
+    signal.state->connect(slot.state, p.value);
+}
+
+template <class Fn, class Policy, class... Params>
+connection connect(const basic_signal<Policy, Params...>& signal, Fn fn)
+{
+  return connect(signal, std::move(fn), priority{0});
+}
+
+template <class Fn, class Policy, class... Params>
+connection connect(const basic_signal<Policy, Params...>& signal, Fn fn,
+                   priority p)
+{
+  using function_t = typename basic_signal<Policy, Params...>::function_t;
+  if (!signal.state)
+    return connection{};
+
+  return connection{signal.state->connect(function_t{std::move(fn)},
+                                          p.value)};
+}
+
+///
+/// \brief A signal which may be used from any thread.
+///
+template <class... Params>
+using signal = basic_signal<multi_threaded, Params...>;
+
 //------------------------------------------------------------------------------
 
 }
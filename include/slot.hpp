@@ -1,11 +1,17 @@
 #ifndef SLOT_HPP
 #define SLOT_HPP
 
+#include "batch.hpp"
 #include "detail/slot_state.hpp"
+#include "inplace_function.hpp"
+#include "memory_resource.hpp"
+#include "tags.hpp"
+#include "threading.hpp"
 
-#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <type_traits>
 #include <utility>
 
 //------------------------------------------------------------------------------
@@ -14,33 +20,53 @@ namespace bb {
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-class signal;
+template <class Policy, class... Params>
+class basic_signal;
+
+class connection_group;
 
 ///
 /// \brief The slot class owns a connection to a signal. The signal will be
 /// disconnected when the slot goes out of scope.
+/// \tparam Policy The threading policy, which must match the signal's.
+/// \tparam Params... The signal parameters.
+/// \note While a slot's function is running, the signal which called it
+/// can't release the state of any slot disconnected from it since the emit
+/// began, so a function which blocks for a long time makes that signal hold
+/// on to every slot disconnected meanwhile. Other signals are unaffected,
+/// since each signal reclaims its disconnected slots independently.
 ///
-template <class... Params>
-class slot
+template <class Policy, class... Params>
+class basic_slot
 {
 public:
   ///
   /// \brief The function type which can be attached to this slot.
   ///
-  using function_t = std::function<void(Params...)>;
+  using function_t = inplace_function<void(Params...)>;
+
+  ///
+  /// \brief The function type which can be attached to a batch-aware slot.
+  ///
+  using batch_function_t = inplace_function<void(const batch<Params...>&)>;
+
+  ///
+  /// \brief The function type which can be attached to a short-circuiting
+  /// slot. It returns whether it handled the event.
+  ///
+  using handler_function_t = inplace_function<bool(Params...)>;
 
   ///
   /// \brief Construct an empty slot.
   ///
-  slot();
+  basic_slot();
 
   ///
   /// \brief Construct a slot which will call the given function when a signal
   /// is received.
   /// \param fn The function to be invoked with the signal parameters.
   ///
-  slot(function_t fn);
+  basic_slot(function_t fn);
 
   ///
   /// \brief Construct a slot which will post the given function to the given
@@ -50,80 +76,423 @@ public:
   /// submitted.
   /// \param fn The function to be invoked with the signal parameters.
   ///
+  template <class Executor,
+            class = typename std::enable_if<
+              !std::is_same<Executor, const batched_t>::value &&
+              !std::is_same<Executor, const reentrant_t>::value &&
+              !std::is_same<Executor, const conflated_t>::value &&
+              !std::is_same<Executor, const short_circuit_t>::value>::type>
+  basic_slot(Executor& executor, function_t fn);
+
+  ///
+  /// \brief Construct a batch-aware slot, which will call the given function
+  /// once with all of the events from each emit_batch(). Single emits are
+  /// delivered as a batch of one.
+  /// \param fn The function to be invoked with each batch.
+  ///
+  basic_slot(batched_t, batch_function_t fn);
+
+  ///
+  /// \brief Construct a batch-aware slot which will post the given function
+  /// to the given executor, once per batch.
+  /// \tparam Executor A type implementing the Executor concept
+  /// \param executor A reference to the executor to which the fn will be
+  /// submitted.
+  /// \param fn The function to be invoked with each batch.
+  ///
   template <class Executor>
-  slot(Executor& executor, function_t fn);
+  basic_slot(batched_t, Executor& executor, batch_function_t fn);
+
+  ///
+  /// \brief Construct a reentrant slot, whose function may be invoked by
+  /// several threads at once.
+  /// \param fn The function to be invoked with the signal parameters. It must
+  /// be safe to call concurrently.
+  ///
+  basic_slot(reentrant_t, function_t fn);
+
+  ///
+  /// \brief Construct a reentrant slot which will post the given function to
+  /// the given executor, where it may run on several threads at once.
+  /// \tparam Executor A type implementing the Executor concept
+  /// \param executor A reference to the executor to which the fn will be
+  /// submitted.
+  /// \param fn The function to be invoked with the signal parameters. It must
+  /// be safe to call concurrently.
+  ///
+  template <class Executor>
+  basic_slot(reentrant_t, Executor& executor, function_t fn);
+
+  ///
+  /// \brief Construct a short-circuiting slot, which can stop an emit from
+  /// reaching the slots after it. It's always invoked on the emitting thread.
+  /// \param fn The function to be invoked with the signal parameters. It
+  /// returns true if it handled the event, in which case the slots after it
+  /// don't receive it. Calls to emit_batch() aren't short-circuited.
+  ///
+  basic_slot(short_circuit_t, handler_function_t fn);
+
+  ///
+  /// \brief Construct a conflated slot which will post the given function to
+  /// the given executor. At most one closure is queued at a time, and it
+  /// delivers the arguments of the most recent emit.
+  /// \tparam Executor A type implementing the Executor concept
+  /// \param executor A reference to the executor to which the fn will be
+  /// submitted.
+  /// \param fn The function to be invoked with the latest signal parameters.
+  ///
+  template <class Executor>
+  basic_slot(conflated_t, Executor& executor, function_t fn);
+
+  ///
+  /// \brief Construct a bounded slot which will queue its events in a mailbox
+  /// in front of the given executor. At most one closure is submitted to the
+  /// executor at a time, and it drains the mailbox in order.
+  /// \tparam Executor A type implementing the Executor concept
+  /// \param options The mailbox's capacity and overflow policy, from
+  /// bb::bounded().
+  /// \param executor A reference to the executor to which the fn will be
+  /// submitted.
+  /// \param fn The function to be invoked with the signal parameters.
+  /// \note With overflow::block, the emitter waits for the executor to make
+  /// room, so it mustn't be the thread which runs the executor.
+  ///
+  template <class Executor>
+  basic_slot(bounded_t options, Executor& executor, function_t fn);
+
+  ///
+  /// \brief Construct a slot whose state is allocated from the given memory
+  /// resource, such as a bb::arena, rather than the heap.
+  /// \param resource The resource, which must outlive the slot and any
+  /// closures it has submitted to its executor.
+  /// \param args The arguments for any of the other constructors, e.g.
+  /// `basic_slot{std::allocator_arg, arena, executor, fn}`.
+  ///
+  template <class... Args>
+  basic_slot(std::allocator_arg_t, memory_resource& resource, Args&&... args);
 
   ///
   /// \brief Copy constructor is deleted.
   ///
-  slot(const slot&) = delete;
+  basic_slot(const basic_slot&) = delete;
 
   ///
   /// \brief Copy assignment operator is deleted.
   ///
-  slot& operator=(const slot&) = delete;
+  basic_slot& operator=(const basic_slot&) = delete;
 
   ///
   /// \brief Move constructor.
   ///
-  slot(slot&&);
+  basic_slot(basic_slot&&);
 
   ///
-  /// \brief Move assignment operator.
+  /// \brief Move assignment operator. Any existing connection is disconnected
+  /// first, as if the slot had been destroyed.
   ///
-  slot& operator=(slot&&);
+  basic_slot& operator=(basic_slot&&);
 
   ///
   /// \brief The destructor will disconnect from the signal.
   /// \note If the function is currently being invoked in another thread then
-  /// the destructor will block until it is finished.
+  /// the destructor will block until it is finished. If the slot is destroyed
+  /// from within its own function, the function is only destroyed once the
+  /// signals have released it.
+  ///
+  ~basic_slot();
+
+  ///
+  /// \brief The number of emits which found the slot's mailbox full. Always
+  /// zero unless the slot is bounded.
   ///
-  ~slot();
+  std::size_t overflow_count() const;
+
+  ///
+  /// \brief Name the slot in the metrics returned by snapshot_metrics().
+  /// Does nothing unless BB_SIGNALS_INSTRUMENTATION is enabled.
+  ///
+  void set_metrics_name(std::string name);
 
 private:
-  template <class... T>
-  friend void connect(const signal<T...>& signal, slot<T...>& slot);
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot, priority p);
 
-  using state_t = detail::slot_state<Params...>;
+  template <class P, class... T>
+  friend void connect(const basic_signal<P, T...>& signal,
+                      basic_slot<P, T...>& slot, priority p,
+                      connection_group& group);
+
+  using state_t = detail::slot_state<Policy, Params...>;
   using shared_state_t = std::shared_ptr<state_t>;
+  using default_allocator_t = std::allocator<state_t>;
+  using resource_allocator_t = resource_allocator<state_t>;
+
+  // Allocate the state for each of the constructors, which resolve to the
+  // same overload with the same arguments.
+  template <class Alloc>
+  static shared_state_t make_state(const Alloc& alloc, function_t fn);
+
+  template <class Alloc, class Executor,
+            class = typename std::enable_if<
+              !std::is_same<Executor, const batched_t>::value &&
+              !std::is_same<Executor, const reentrant_t>::value &&
+              !std::is_same<Executor, const conflated_t>::value &&
+              !std::is_same<Executor, const short_circuit_t>::value>::type>
+  static shared_state_t make_state(const Alloc& alloc, Executor& executor,
+                                   function_t fn);
+
+  template <class Alloc>
+  static shared_state_t make_state(const Alloc& alloc, batched_t,
+                                   batch_function_t fn);
+
+  template <class Alloc, class Executor>
+  static shared_state_t make_state(const Alloc& alloc, batched_t,
+                                   Executor& executor, batch_function_t fn);
+
+  template <class Alloc>
+  static shared_state_t make_state(const Alloc& alloc, reentrant_t,
+                                   function_t fn);
+
+  template <class Alloc, class Executor>
+  static shared_state_t make_state(const Alloc& alloc, reentrant_t,
+                                   Executor& executor, function_t fn);
+
+  template <class Alloc>
+  static shared_state_t make_state(const Alloc& alloc, short_circuit_t,
+                                   handler_function_t fn);
+
+  template <class Alloc, class Executor>
+  static shared_state_t make_state(const Alloc& alloc, conflated_t,
+                                   Executor& executor, function_t fn);
+
+  template <class Alloc, class Executor>
+  static shared_state_t make_state(const Alloc& alloc, bounded_t options,
+                                   Executor& executor, function_t fn);
 
   shared_state_t state;
 };
 
 //------------------------------------------------------------------------------
 
-template <class... Params>
-slot<Params...>::slot() = default;
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot() = default;
 
-template <class... Params>
-slot<Params...>::slot(function_t fn)
-  : state{std::make_shared<state_t>(std::move(fn))}
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot(function_t fn)
+  : state{make_state(default_allocator_t{}, std::move(fn))}
 {
 }
 
-template <class... Params>
+template <class Policy, class... Params>
+template <class Executor, class>
+basic_slot<Policy, Params...>::basic_slot(Executor& executor,
+                                          function_t fn)
+  : state{make_state(default_allocator_t{}, executor, std::move(fn))}
+{
+}
+
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot(batched_t, batch_function_t fn)
+  : state{make_state(default_allocator_t{}, batched, std::move(fn))}
+{
+}
+
+template <class Policy, class... Params>
 template <class Executor>
-slot<Params...>::slot(Executor& executor, function_t fn)
-  : state{std::make_shared<state_t>(executor, std::move(fn))}
+basic_slot<Policy, Params...>::basic_slot(batched_t, Executor& executor,
+                                          batch_function_t fn)
+  : state{make_state(default_allocator_t{}, batched, executor,
+                     std::move(fn))}
 {
 }
 
-template <class... Params>
-slot<Params...>::slot(slot&&) = default;
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot(reentrant_t, function_t fn)
+  : state{make_state(default_allocator_t{}, reentrant, std::move(fn))}
+{
+}
 
-template <class... Params>
-slot<Params...>& slot<Params...>::operator=(slot&&) = default;
+template <class Policy, class... Params>
+template <class Executor>
+basic_slot<Policy, Params...>::basic_slot(reentrant_t, Executor& executor,
+                                          function_t fn)
+  : state{make_state(default_allocator_t{}, reentrant, executor,
+                     std::move(fn))}
+{
+}
 
-template <class... Params>
-slot<Params...>::~slot()
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot(short_circuit_t,
+                                          handler_function_t fn)
+  : state{make_state(default_allocator_t{}, short_circuit, std::move(fn))}
+{
+}
+
+template <class Policy, class... Params>
+template <class Executor>
+basic_slot<Policy, Params...>::basic_slot(conflated_t, Executor& executor,
+                                          function_t fn)
+  : state{make_state(default_allocator_t{}, conflated, executor,
+                     std::move(fn))}
 {
-  // This will block until the internal mutex is locked and the function has
-  // been cleared. This is essential because the state itself might outlive
-  // "this", but we don't want that to mean that the function might be invoked
-  // after this destructor has returned.
+}
+
+template <class Policy, class... Params>
+template <class Executor>
+basic_slot<Policy, Params...>::basic_slot(bounded_t options,
+                                          Executor& executor, function_t fn)
+  : state{make_state(default_allocator_t{}, options, executor,
+                     std::move(fn))}
+{
+}
+
+template <class Policy, class... Params>
+template <class... Args>
+basic_slot<Policy, Params...>::basic_slot(std::allocator_arg_t,
+                                          memory_resource& resource,
+                                          Args&&... args)
+  : state{make_state(resource_allocator_t{&resource},
+                     std::forward<Args>(args)...)}
+{
+}
+
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::basic_slot(basic_slot&&) = default;
+
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>&
+basic_slot<Policy, Params...>::operator=(basic_slot&& other)
+{
+  if (this != &other)
+  {
+    if (state) state->reset();
+    state = std::move(other.state);
+  }
+  return *this;
+}
+
+template <class Policy, class... Params>
+basic_slot<Policy, Params...>::~basic_slot()
+{
+  // This will block until any invocations in progress have finished and the
+  // function has been cleared. This is essential because the state itself
+  // might outlive "this", but we don't want that to mean that the function
+  // might be invoked after this destructor has returned.
   if (state) state->reset();
 }
 
+template <class Policy, class... Params>
+std::size_t basic_slot<Policy, Params...>::overflow_count() const
+{
+  return state ? state->overflow_count() : 0;
+}
+
+template <class Policy, class... Params>
+void basic_slot<Policy, Params...>::set_metrics_name(std::string name)
+{
+  if (state)
+    state->set_metrics_name(std::move(name));
+}
+
+template <class Policy, class... Params>
+template <class Alloc>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc, class Executor, class>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc,
+                                          Executor& executor, function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       executor, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, batched_t,
+                                          batch_function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc, class Executor>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, batched_t,
+                                          Executor& executor,
+                                          batch_function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       executor, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, reentrant_t,
+                                          function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       reentrant, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc, class Executor>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, reentrant_t,
+                                          Executor& executor, function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       reentrant, executor, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc,
+                                          short_circuit_t,
+                                          handler_function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       short_circuit, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc, class Executor>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc, conflated_t,
+                                          Executor& executor, function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       conflated, executor, std::move(fn));
+}
+
+template <class Policy, class... Params>
+template <class Alloc, class Executor>
+typename basic_slot<Policy, Params...>::shared_state_t
+basic_slot<Policy, Params...>::make_state(const Alloc& alloc,
+                                          bounded_t options,
+                                          Executor& executor, function_t fn)
+{
+  return std::allocate_shared<state_t>(alloc, detail::resource_of(alloc),
+                                       options, executor, std::move(fn));
+}
+
+///
+/// \brief A slot for signals which may be used from any thread.
+///
+template <class... Params>
+using slot = basic_slot<multi_threaded, Params...>;
+
 //------------------------------------------------------------------------------
 
 }
@@ -0,0 +1,213 @@
+#ifndef STATIC_SIGNAL_HPP
+#define STATIC_SIGNAL_HPP
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+template <class... Slots>
+class static_emitter;
+
+///
+/// \brief A signal whose slots are fixed by its type, for wiring which is
+/// known at compile time. The signal owns one instance of each slot type, and
+/// emitting calls each of them directly, in order, so the whole emit can be
+/// inlined. Nothing is allocated, locked or reference counted.
+/// \tparam Slots... The function object types which receive the signal.
+/// \note Slots are invoked on the emitting thread without any
+/// synchronization, so they must be safe to call from every thread which
+/// emits.
+/// \note Unlike a dynamic signal, a static_signal isn't disconnected from its
+/// emitters when it's destroyed: they refer to it directly. The signal must
+/// outlive every emitter connected to it, or those emitters must not be
+/// called after it's destroyed.
+///
+template <class... Slots>
+class static_signal
+{
+public:
+  ///
+  /// \brief Construct a signal with default-constructed slots.
+  ///
+  static_signal() = default;
+
+  ///
+  /// \brief Construct a signal with the given slots. A signal without slots
+  /// only has the default constructor.
+  ///
+  template <bool HasSlots = (sizeof...(Slots) > 0),
+            class = typename std::enable_if<HasSlots>::type>
+  explicit static_signal(Slots... slots);
+
+  ///
+  /// \brief Deleted copy constructor. Emitters refer to the signal, so it
+  /// can't be copied or moved.
+  ///
+  static_signal(const static_signal&) = delete;
+
+  ///
+  /// \brief Deleted copy assignment operator.
+  ///
+  static_signal& operator=(const static_signal&) = delete;
+
+  ///
+  /// \brief Access one of the slots.
+  /// \tparam I The index of the slot in Slots.
+  ///
+  template <std::size_t I>
+  typename std::tuple_element<I, std::tuple<Slots...>>::type& slot();
+
+  ///
+  /// \brief Connect an emitter to a signal, so that calling the emitter will
+  /// invoke the signal's slots.
+  /// \param emitter The sending emitter.
+  /// \param signal The receiving signal.
+  /// \note Any existing connection from the emitter is replaced. The signal
+  /// must outlive every call to the emitter.
+  ///
+  template <class... S>
+  friend void connect(static_emitter<S...>& emitter,
+                      static_signal<S...>& signal);
+
+private:
+  friend class static_emitter<Slots...>;
+
+  template <class... Args>
+  void emit(Args&&... args);
+
+  template <std::size_t... I, class Args>
+  void emit(std::index_sequence<I...>, Args&& args);
+
+  // Every slot but the last receives the arguments as lvalues, and they are
+  // forwarded to the last one, as for dynamic signals.
+  template <std::size_t I, class Args, std::size_t... J>
+  void invoke(Args& args, std::index_sequence<J...>, std::false_type);
+
+  template <std::size_t I, class Args, std::size_t... J>
+  void invoke(Args& args, std::index_sequence<J...>, std::true_type);
+
+  std::tuple<Slots...> slots;
+};
+
+///
+/// \brief An emitter for a static_signal. Copies of an emitter emit to the
+/// same signal.
+/// \tparam Slots... The slot types of the signal.
+/// \note The emitter holds a plain pointer to its signal, so calling it after
+/// the signal has been destroyed is undefined behaviour. Keep the signal alive
+/// for as long as any emitter connected to it can be called.
+///
+template <class... Slots>
+class static_emitter
+{
+public:
+  ///
+  /// \brief Construct an emitter which isn't connected to a signal.
+  ///
+  static_emitter() = default;
+
+  ///
+  /// \brief Invoke each of the connected signal's slots in order. Does
+  /// nothing if the emitter isn't connected.
+  /// \param args The arguments with which to emit the signal. Rvalue
+  /// arguments are moved into the last slot, and passed by reference to the
+  /// others.
+  ///
+  template <class... Args>
+  void operator()(Args&&... args) const;
+
+  ///
+  /// \brief Connect an emitter to a signal. The signal must outlive the
+  /// emitter, or at least every call to it.
+  ///
+  template <class... S>
+  friend void connect(static_emitter<S...>& emitter,
+                      static_signal<S...>& signal);
+
+private:
+  // Not owning: the signal must outlive every call to the emitter.
+  static_signal<Slots...>* signal = nullptr;
+};
+
+//------------------------------------------------------------------------------
+
+template <class... Slots>
+template <bool HasSlots, class>
+static_signal<Slots...>::static_signal(Slots... slots)
+  : slots{std::move(slots)...}
+{
+}
+
+template <class... Slots>
+template <std::size_t I>
+typename std::tuple_element<I, std::tuple<Slots...>>::type&
+static_signal<Slots...>::slot()
+{
+  return std::get<I>(slots);
+}
+
+template <class... Slots>
+template <class... Args>
+void static_signal<Slots...>::emit(Args&&... args)
+{
+  emit(std::index_sequence_for<Slots...>{},
+       std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <class... Slots>
+template <std::size_t... I, class Args>
+void static_signal<Slots...>::emit(std::index_sequence<I...>, Args&& args)
+{
+  using arguments = std::make_index_sequence<
+    std::tuple_size<typename std::decay<Args>::type>::value>;
+
+  using expand = int[];
+  (void)expand{0, (invoke<I>(args, arguments{},
+    std::integral_constant<bool, I + 1 == sizeof...(Slots)>{}), 0)...};
+}
+
+template <class... Slots>
+template <std::size_t I, class Args, std::size_t... J>
+void static_signal<Slots...>::invoke(Args& args, std::index_sequence<J...>,
+                                     std::false_type)
+{
+  std::get<I>(slots)(std::get<J>(args)...);
+}
+
+template <class... Slots>
+template <std::size_t I, class Args, std::size_t... J>
+void static_signal<Slots...>::invoke(Args& args, std::index_sequence<J...>,
+                                     std::true_type)
+{
+  std::get<I>(slots)(std::get<J>(std::move(args))...);
+}
+
+template <class... Slots>
+void connect(static_emitter<Slots...>& emitter,
+             static_signal<Slots...>& signal)
+{
+  emitter.signal = &signal;
+}
+
+template <class... Slots>
+template <class... Args>
+void static_emitter<Slots...>::operator()(Args&&... args) const
+{
+  if (signal)
+    signal->emit(std::forward<Args>(args)...);
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // STATIC_SIGNAL_HPP
@@ -0,0 +1,132 @@
+#ifndef TAGS_HPP
+#define TAGS_HPP
+
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Tag type used to construct a batch-aware slot.
+///
+struct batched_t
+{ };
+
+///
+/// \brief Construct a slot with this tag to receive whole batches of events.
+///
+constexpr batched_t batched{};
+
+///
+/// \brief Tag type used to construct a reentrant slot.
+///
+struct reentrant_t
+{ };
+
+///
+/// \brief Construct a slot with this tag to allow its function to be invoked
+/// by several threads at once. Reentrant slots don't lock on each invocation,
+/// so concurrent emits run in parallel; the function must be safe to call
+/// concurrently.
+///
+constexpr reentrant_t reentrant{};
+
+///
+/// \brief Tag type used to construct a conflated slot.
+///
+struct conflated_t
+{ };
+
+///
+/// \brief Construct a slot with this tag to only ever have one closure queued
+/// on its executor. Emits which arrive while the closure is still queued
+/// overwrite its arguments, so the slot always receives the latest values and
+/// skips any stale ones in between.
+///
+constexpr conflated_t conflated{};
+
+///
+/// \brief What a bounded slot does with an emit when its mailbox is full.
+///
+enum class overflow
+{
+  /// Block the emitter until the slot has made room.
+  block,
+  /// Discard the new event.
+  drop_newest,
+  /// Discard the oldest queued event to make room for the new one.
+  drop_oldest
+};
+
+///
+/// \brief The options with which to construct a bounded slot.
+///
+struct bounded_t
+{
+  std::size_t capacity;
+  overflow policy;
+};
+
+///
+/// \brief Construct a slot with these options to queue its events in a
+/// bounded mailbox in front of its executor. At most one closure per slot is
+/// submitted to the executor at a time, and it drains the mailbox.
+/// \param capacity The maximum number of queued events. A capacity of one
+/// keeps only a single pending event; zero is treated as one.
+/// \param policy What to do when the mailbox is full.
+///
+constexpr bounded_t bounded(std::size_t capacity,
+                            overflow policy = overflow::block)
+{
+  return bounded_t{capacity, policy};
+}
+
+///
+/// \brief Tag type used to construct a short-circuiting slot.
+///
+struct short_circuit_t
+{ };
+
+///
+/// \brief Construct a slot with this tag to be able to stop an emit. The
+/// slot's function returns true once it has handled the event, and then no
+/// slots after it receive the event. Short-circuiting slots are invoked
+/// inline, so that the emit can see the result.
+///
+constexpr short_circuit_t short_circuit{};
+
+///
+/// \brief The priority with which a slot is connected to a signal. Slots
+/// with a higher priority are invoked first, and slots with equal priority
+/// are invoked in the order they were connected. The default priority is
+/// zero.
+///
+struct priority
+{
+  int value;
+};
+
+///
+/// \brief Tag type used to join an emitter to a signal.
+///
+struct join_t
+{ };
+
+///
+/// \brief Connect an emitter to a signal with this tag to add the signal to
+/// the emitter's targets, sharing the signal's existing state rather than
+/// replacing it. Several emitters can be joined to one signal, and one
+/// emitter can be joined to several signals.
+///
+constexpr join_t join{};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // TAGS_HPP
@@ -0,0 +1,278 @@
+#ifndef THREAD_POOL_EXECUTOR_HPP
+#define THREAD_POOL_EXECUTOR_HPP
+
+#include "detail/mpmc_queue.hpp"
+#include "detail/task.hpp"
+#include "detail/work_stealing_deque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief An executor which runs closures on a pool of worker threads.
+///
+/// Each worker has its own lock-free deque. Closures submitted by a worker,
+/// such as those posted by a slot which emits another signal, go onto that
+/// worker's deque, and idle workers steal from the others. Closures submitted
+/// from other threads go through a lock-free injection queue. Submitting
+/// never takes a lock unless a worker is asleep and needs waking.
+///
+class thread_pool_executor
+{
+public:
+  ///
+  /// \brief Construct a pool and start its workers.
+  /// \param threads The number of worker threads. Defaults to the number of
+  /// hardware threads.
+  ///
+  explicit thread_pool_executor(
+    std::size_t threads = std::thread::hardware_concurrency());
+
+  thread_pool_executor(const thread_pool_executor&) = delete;
+  thread_pool_executor& operator=(const thread_pool_executor&) = delete;
+
+  ///
+  /// \brief Run any closures which are still queued, then stop the workers.
+  /// Nothing may submit to the pool from outside it once destruction has
+  /// begun.
+  ///
+  ~thread_pool_executor();
+
+  ///
+  /// \brief Submit a closure to be run by one of the workers. The closure is
+  /// moved straight into the pool's queued task, which is the only
+  /// allocation.
+  /// \param closure The closure. It must not throw.
+  ///
+  template <class Closure,
+            class Fn = typename std::decay<Closure>::type,
+            class = decltype(std::declval<Fn&>()())>
+  void submit(Closure&& closure);
+
+  ///
+  /// \brief Submit a closure which has already been wrapped in a task, as
+  /// slots do, so that it isn't wrapped again.
+  ///
+  void submit(std::unique_ptr<detail::task> t);
+
+  ///
+  /// \brief The number of worker threads.
+  ///
+  std::size_t size() const;
+
+private:
+  using task = detail::task;
+
+  struct worker
+  {
+    detail::work_stealing_deque<task> tasks;
+    std::thread thread;
+  };
+
+  struct worker_context
+  {
+    const thread_pool_executor* pool;
+    std::size_t index;
+  };
+
+  // The pool and worker index of the calling thread, if it's a worker.
+  static worker_context& context();
+
+  void run(std::size_t index);
+  task* find_task(std::size_t index);
+  bool has_task() const;
+  bool wait_for_task();
+  void wake();
+
+  // The number of times an idle worker looks for a closure before sleeping.
+  static constexpr int spin_count = 64;
+
+  std::vector<std::unique_ptr<worker>> workers;
+  detail::mpmc_queue<task*> injected{1024};
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::atomic<std::size_t> sleepers{0};
+  bool stopping = false;
+};
+
+///
+/// \brief A process-wide pool with a worker per hardware thread, which is
+/// started on first use, for callers which don't manage their own pool.
+/// \code
+/// emitter.emit_parallel(bb::default_thread_pool(), args...);
+/// \endcode
+///
+thread_pool_executor& default_thread_pool();
+
+//------------------------------------------------------------------------------
+
+inline thread_pool_executor::thread_pool_executor(std::size_t threads)
+{
+  threads = std::max<std::size_t>(threads, 1);
+
+  // Create every worker before starting any of them, since they steal from
+  // each other.
+  workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i)
+    workers.push_back(std::make_unique<worker>());
+
+  for (std::size_t i = 0; i < threads; ++i)
+    workers[i]->thread = std::thread{[this, i]{ run(i); }};
+}
+
+inline thread_pool_executor::~thread_pool_executor()
+{
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  condition.notify_all();
+
+  for (auto& w : workers)
+    w->thread.join();
+}
+
+template <class Closure, class Fn, class>
+void thread_pool_executor::submit(Closure&& closure)
+{
+  submit(detail::make_task(std::forward<Closure>(closure)));
+}
+
+inline void thread_pool_executor::submit(std::unique_ptr<task> t)
+{
+  const worker_context& local = context();
+
+  if (local.pool == this)
+  {
+    workers[local.index]->tasks.push(t.release());
+  }
+  else
+  {
+    // The injection queue is bounded, so wait for the workers to make room.
+    while (!injected.try_push(t.get()))
+      std::this_thread::yield();
+    t.release();
+  }
+
+  wake();
+}
+
+inline std::size_t thread_pool_executor::size() const
+{
+  return workers.size();
+}
+
+inline thread_pool_executor::worker_context& thread_pool_executor::context()
+{
+  thread_local worker_context local{nullptr, 0};
+  return local;
+}
+
+inline void thread_pool_executor::run(std::size_t index)
+{
+  context() = worker_context{this, index};
+
+  while (true)
+  {
+    task* t = nullptr;
+    for (int i = 0; !t && i < spin_count; ++i)
+    {
+      t = find_task(index);
+      if (!t)
+        std::this_thread::yield();
+    }
+
+    if (t)
+      std::unique_ptr<task>{t}->run();
+    else if (!wait_for_task())
+      return;
+  }
+}
+
+inline thread_pool_executor::task*
+thread_pool_executor::find_task(std::size_t index)
+{
+  if (task* t = workers[index]->tasks.pop())
+    return t;
+
+  task* t = nullptr;
+  if (injected.try_pop(t))
+    return t;
+
+  // Steal from the other workers in turn, starting with the next one, so that
+  // thieves spread out rather than all targeting the same victim.
+  for (std::size_t i = 1; i < workers.size() && !t; ++i)
+    t = workers[(index + i) % workers.size()]->tasks.steal();
+
+  return t;
+}
+
+inline bool thread_pool_executor::has_task() const
+{
+  return !injected.empty() ||
+         std::any_of(workers.begin(), workers.end(),
+                     [](const std::unique_ptr<worker>& w)
+                     { return !w->tasks.empty(); });
+}
+
+inline bool thread_pool_executor::wait_for_task()
+{
+  std::unique_lock<std::mutex> lock{mutex};
+
+  // Announce that this worker is going to sleep before checking for work
+  // one last time, so that a concurrent submit() either sees the announcement
+  // and wakes it, or its closure is seen here.
+  sleepers.fetch_add(1, std::memory_order_seq_cst);
+
+  bool found = true;
+  while (!has_task())
+  {
+    if (stopping)
+    {
+      found = false;
+      break;
+    }
+    condition.wait(lock);
+  }
+
+  sleepers.fetch_sub(1, std::memory_order_relaxed);
+  return found;
+}
+
+inline void thread_pool_executor::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers.load(std::memory_order_seq_cst) == 0)
+    return;
+
+  std::unique_lock<std::mutex> lock{mutex};
+  condition.notify_one();
+}
+
+inline thread_pool_executor& default_thread_pool()
+{
+  static thread_pool_executor pool;
+  return pool;
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // THREAD_POOL_EXECUTOR_HPP
@@ -0,0 +1,33 @@
+#ifndef THREADING_HPP
+#define THREADING_HPP
+
+//------------------------------------------------------------------------------
+
+namespace bb {
+
+//------------------------------------------------------------------------------
+
+///
+/// \brief Threading policy for signals which may be emitted, connected and
+/// disconnected from any thread. This is the default.
+///
+struct multi_threaded
+{ };
+
+///
+/// \brief Threading policy for signals which are only ever used from a single
+/// thread, such as inside a reactor. All locking and atomic operations are
+/// compiled away, and emitting doesn't touch any reference counts.
+/// \note A single-threaded signal must not be destroyed by one of its own
+/// slots while it's being emitted.
+///
+struct single_threaded
+{ };
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+#endif // THREADING_HPP
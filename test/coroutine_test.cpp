@@ -0,0 +1,358 @@
+#include "coroutine.hpp"
+#include "emitter.hpp"
+#include "signal.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// A coroutine which starts immediately, and whose frame is destroyed either
+// when it finishes or when the task is destroyed, whichever is later. A
+// lambda which defines a coroutine must outlive it, since the coroutine refers
+// to the lambda's captures.
+class task
+{
+public:
+  struct promise_type
+  {
+    task get_return_object()
+    {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() { }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  task(task&& other)
+    : handle(std::exchange(other.handle, nullptr))
+  { }
+
+  ~task()
+  {
+    if (handle)
+      handle.destroy();
+  }
+
+  bool done() const
+  {
+    return handle.done();
+  }
+
+private:
+  explicit task(std::coroutine_handle<promise_type> handle)
+    : handle(handle)
+  { }
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+// Check that awaiting next() resumes the coroutine with the arguments of the
+// next emit, on the emitting thread.
+TEST(coroutine_test, next_receives_emission)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> received;
+  auto consumer_body = [&]() -> task
+  {
+    received.push_back(co_await bb::next(signal));
+    received.push_back(co_await bb::next(signal));
+  };
+  auto consumer = consumer_body();
+
+  EXPECT_TRUE(received.empty());
+  emit_signal(1);
+  EXPECT_EQ((vector<int>{1}), received);
+  EXPECT_FALSE(consumer.done());
+  emit_signal(2);
+  EXPECT_EQ((vector<int>{1, 2}), received);
+  EXPECT_TRUE(consumer.done());
+
+  // Nothing is connected any more.
+  emit_signal(3);
+  EXPECT_EQ((vector<int>{1, 2}), received);
+}
+
+// Check the results of awaiting signals with no parameters and with several.
+TEST(coroutine_test, next_results)
+{
+  bb::emitter<> emit_void;
+  bb::signal<> void_signal;
+  bb::connect(emit_void, void_signal);
+
+  bb::emitter<int, const string&> emit_pair;
+  bb::signal<int, const string&> pair_signal;
+  bb::connect(emit_pair, pair_signal);
+
+  tuple<int, string> received;
+  auto consumer_body = [&]() -> task
+  {
+    co_await bb::next(void_signal);
+    received = co_await bb::next(pair_signal);
+  };
+  auto consumer = consumer_body();
+
+  emit_pair(0, "ignored");
+  emit_void();
+  EXPECT_FALSE(consumer.done());
+  emit_pair(1, "one");
+  EXPECT_TRUE(consumer.done());
+  EXPECT_EQ(make_tuple(1, string{"one"}), received);
+}
+
+// Check that a stream delivers every emission in order, including those
+// emitted while the coroutine wasn't awaiting.
+TEST(coroutine_test, stream_buffers_emissions)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> received;
+  auto consumer_body = [&]() -> task
+  {
+    auto stream = bb::emissions(signal);
+    while (true)
+    {
+      int value = co_await stream.next();
+      if (value == 0)
+        break;
+      received.push_back(value);
+
+      // Emitting from within the resumed coroutine buffers the emission.
+      if (value == 1)
+        emit_signal(2);
+    }
+  };
+  auto consumer = consumer_body();
+
+  emit_signal(1);
+  EXPECT_EQ((vector<int>{1, 2}), received);
+  emit_signal(3);
+  emit_signal(0);
+  EXPECT_TRUE(consumer.done());
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+
+  // The stream was destroyed with the coroutine, so it's disconnected.
+  emit_signal(4);
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+}
+
+// Check that destroying a suspended coroutine disconnects it.
+TEST(coroutine_test, destroyed_coroutine_is_disconnected)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  {
+    auto next_consumer_body = [&]() -> task
+    {
+      received += co_await bb::next(signal);
+    };
+    auto next_consumer = next_consumer_body();
+
+    auto stream_consumer_body = [&]() -> task
+    {
+      auto stream = bb::emissions(signal);
+      while (true)
+        received += co_await stream.next();
+    };
+    auto stream_consumer = stream_consumer_body();
+  }
+
+  emit_signal(1);
+  EXPECT_EQ(0, received);
+}
+
+// Check that awaiting a stream which has been moved from waits without
+// receiving anything, while the stream it was moved to still receives.
+TEST(coroutine_test, moved_from_stream)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  auto stream = bb::emissions(signal);
+  auto moved = std::move(stream);
+
+  int received = 0;
+  auto consumer_body = [&](bb::emission_stream<bb::multi_threaded, int>& s)
+    -> task
+  {
+    received += co_await s.next();
+  };
+
+  {
+    auto consumer = consumer_body(stream);
+    emit_signal(1);
+    EXPECT_FALSE(consumer.done());
+    EXPECT_EQ(0, received);
+  }
+
+  auto consumer = consumer_body(moved);
+  EXPECT_TRUE(consumer.done());
+  EXPECT_EQ(1, received);
+}
+
+// Check that destroying a coroutine suspended on a stream which outlives it
+// leaves the stream buffering emissions for the next consumer.
+TEST(coroutine_test, destroyed_consumer_of_surviving_stream)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  auto stream = bb::emissions(signal);
+
+  int received = 0;
+  auto consumer_body = [&]() -> task
+  {
+    while (true)
+      received += co_await stream.next();
+  };
+
+  {
+    auto consumer = consumer_body();
+    emit_signal(1);
+    EXPECT_EQ(1, received);
+  }
+
+  emit_signal(2);
+  EXPECT_EQ(1, received);
+
+  auto consumer = consumer_body();
+  EXPECT_EQ(3, received);
+}
+
+// Check that a coroutine can consume a stream emitted from another thread.
+TEST(coroutine_test, stream_from_another_thread)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  constexpr int count = 10000;
+  atomic<long> sum{0};
+
+  auto consumer_body = [&]() -> task
+  {
+    auto stream = bb::emissions(signal);
+    for (int i = 0; i < count; ++i)
+      sum += co_await stream.next();
+  };
+  auto consumer = consumer_body();
+
+  std::thread emitter{[&]
+  {
+    for (int i = 1; i <= count; ++i)
+      emit_signal(i);
+  }};
+  emitter.join();
+
+  EXPECT_TRUE(consumer.done());
+  EXPECT_EQ(static_cast<long>(count) * (count + 1) / 2, sum.load());
+}
+
+// Check that single-threaded signals can be awaited too.
+TEST(coroutine_test, single_threaded_signal)
+{
+  bb::basic_emitter<bb::single_threaded, int> emit_signal;
+  bb::basic_signal<bb::single_threaded, int> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  auto consumer_body = [&]() -> task
+  {
+    auto stream = bb::emissions(signal);
+    received += co_await stream.next();
+    received += co_await bb::next(signal);
+  };
+  auto consumer = consumer_body();
+
+  emit_signal(1);
+  emit_signal(2);
+  EXPECT_TRUE(consumer.done());
+  EXPECT_EQ(3, received);
+}
+
+// A resource which counts its outstanding allocations.
+class counting_resource : public bb::memory_resource
+{
+public:
+  std::size_t outstanding = 0;
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    ++outstanding;
+    return bb::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override
+  {
+    --outstanding;
+    bb::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const bb::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+// Check that a stream, its connection and its buffered emissions are
+// allocated from the signal's memory resource.
+TEST(coroutine_test, stream_uses_signal_resource)
+{
+  counting_resource resource;
+
+  {
+    bb::emitter<int> emit_signal;
+    bb::signal<int> signal;
+    bb::connect(allocator_arg, resource, emit_signal, signal);
+    auto connected = resource.outstanding;
+
+    auto stream = bb::emissions(signal);
+    EXPECT_LT(connected + 1, resource.outstanding);
+    emit_signal(1);
+  }
+
+  EXPECT_EQ(0u, resource.outstanding);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+#define BB_SIGNALS_INSTRUMENTATION 1
+
+#include "emitter.hpp"
+#include "instrumentation.hpp"
+#include "signal.hpp"
+#include "slot.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// An executor which queues closures until they are explicitly run.
+class queue_executor
+{
+public:
+  void submit(std::function<void()> closure)
+  {
+    closures.push_back(std::move(closure));
+  }
+
+  void run()
+  {
+    while (!closures.empty())
+    {
+      auto closure = std::move(closures.front());
+      closures.pop_front();
+      closure();
+    }
+  }
+
+private:
+  std::deque<std::function<void()>> closures;
+};
+
+template <class Metrics>
+const Metrics* find(const vector<Metrics>& metrics, const string& name)
+{
+  auto it = std::find_if(metrics.begin(), metrics.end(),
+                         [&](const Metrics& m) { return m.name == name; });
+  return it == metrics.end() ? nullptr : &*it;
+}
+
+//------------------------------------------------------------------------------
+
+}
+
+//------------------------------------------------------------------------------
+
+// Check that a signal counts its emits, the slots they visit, and the
+// disconnected slots it removes.
+TEST(instrumentation_test, signal_metrics)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+  signal.set_metrics_name("signal_metrics");
+
+  bb::slot<int> first{[](int){ }};
+  auto second = std::make_unique<bb::slot<int>>([](int){ });
+  bb::connect(signal, first);
+  bb::connect(signal, *second);
+
+  emit_signal(1);
+  emit_signal(2);
+  second.reset();
+  emit_signal(3);
+
+  // The tombstone made up half of the table, so disconnecting compacted it
+  // before the third emit.
+  auto snapshot = bb::snapshot_metrics();
+  auto metrics = find(snapshot.signals, "signal_metrics");
+  ASSERT_NE(nullptr, metrics);
+  EXPECT_EQ(3u, metrics->emits);
+  EXPECT_EQ(5u, metrics->slots_visited);
+  EXPECT_EQ(1u, metrics->connections_reaped);
+  EXPECT_GE(metrics->lock_wait.count(), 0);
+}
+
+// Check that a slot counts its invocations and times a sample of them.
+TEST(instrumentation_test, slot_metrics)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  bb::slot<int> slot{[](int){ }};
+  slot.set_metrics_name("slot_metrics");
+  bb::connect(signal, slot);
+
+  constexpr int emits = 2 * BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE;
+  for (int i = 0; i < emits; ++i)
+    emit_signal(i);
+
+  auto snapshot = bb::snapshot_metrics();
+  auto metrics = find(snapshot.slots, "slot_metrics");
+  ASSERT_NE(nullptr, metrics);
+  EXPECT_EQ(static_cast<std::uint64_t>(emits), metrics->invocations);
+  EXPECT_EQ(2u, metrics->sampled_invocations);
+  EXPECT_EQ(0u, metrics->sampled_closures);
+}
+
+// Check that a slot with an executor times how long a sample of its closures
+// spend queued.
+TEST(instrumentation_test, queue_latency)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  bb::slot<int> slot{executor, [](int){ }};
+  slot.set_metrics_name("queue_latency");
+  bb::connect(signal, slot);
+
+  constexpr int emits = 2 * BB_SIGNALS_INSTRUMENTATION_SAMPLE_RATE;
+  for (int i = 0; i < emits; ++i)
+    emit_signal(i);
+  std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  executor.run();
+
+  auto snapshot = bb::snapshot_metrics();
+  auto metrics = find(snapshot.slots, "queue_latency");
+  ASSERT_NE(nullptr, metrics);
+  EXPECT_EQ(static_cast<std::uint64_t>(emits), metrics->invocations);
+  EXPECT_EQ(2u, metrics->sampled_closures);
+  EXPECT_GE(metrics->sampled_queue_latency, std::chrono::milliseconds{2});
+}
+
+// Check that emits from several threads are all counted.
+TEST(instrumentation_test, concurrent_emits)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+  signal.set_metrics_name("concurrent_emits");
+
+  bb::slot<int> slot{bb::reentrant, [](int){ }};
+  slot.set_metrics_name("concurrent_emits");
+  bb::connect(signal, slot);
+
+  constexpr int threads = 4;
+  constexpr int emits = 10000;
+  vector<std::thread> emitters;
+  for (int t = 0; t < threads; ++t)
+  {
+    emitters.emplace_back([&]
+    {
+      for (int i = 0; i < emits; ++i)
+        emit_signal(i);
+    });
+  }
+  for (auto& t : emitters)
+    t.join();
+
+  auto snapshot = bb::snapshot_metrics();
+  auto signal_metrics = find(snapshot.signals, "concurrent_emits");
+  auto slot_metrics = find(snapshot.slots, "concurrent_emits");
+  ASSERT_NE(nullptr, signal_metrics);
+  ASSERT_NE(nullptr, slot_metrics);
+  EXPECT_EQ(static_cast<std::uint64_t>(threads * emits),
+            signal_metrics->emits);
+  EXPECT_EQ(static_cast<std::uint64_t>(threads * emits),
+            slot_metrics->invocations);
+}
+
+// Check that destroyed signals and slots are removed from the registry.
+TEST(instrumentation_test, destroyed_objects_are_unregistered)
+{
+  {
+    bb::emitter<> emit_signal;
+    bb::signal<> signal;
+    bb::connect(emit_signal, signal);
+    signal.set_metrics_name("destroyed");
+
+    bb::slot<> slot{[]{ }};
+    slot.set_metrics_name("destroyed");
+
+    auto snapshot = bb::snapshot_metrics();
+    EXPECT_NE(nullptr, find(snapshot.signals, "destroyed"));
+    EXPECT_NE(nullptr, find(snapshot.slots, "destroyed"));
+  }
+
+  auto snapshot = bb::snapshot_metrics();
+  EXPECT_EQ(nullptr, find(snapshot.signals, "destroyed"));
+  EXPECT_EQ(nullptr, find(snapshot.slots, "destroyed"));
+}
+
+// Check that snapshots can be taken while signals and slots are being created
+// and destroyed on another thread.
+TEST(instrumentation_test, snapshot_during_destruction)
+{
+  std::atomic<bool> done{false};
+  std::thread churn{[&]
+  {
+    for (int i = 0; i < 2000; ++i)
+    {
+      bb::signal<> signal;
+      bb::slot<> slot{[]{ }};
+    }
+    done = true;
+  }};
+
+  while (!done)
+    bb::snapshot_metrics();
+
+  churn.join();
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,22 +1,104 @@
+#include "arena.hpp"
+#include "connection_group.hpp"
 #include "emitter.hpp"
+#include "inplace_function.hpp"
+#include "memory_resource.hpp"
+#include "queued_signal.hpp"
+#include "result_signal.hpp"
 #include "signal.hpp"
 #include "slot.hpp"
+#include "static_signal.hpp"
+#include "thread_pool_executor.hpp"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
+// Count the heap allocations made by each thread, so that tests can check
+// which operations allocate.
+static thread_local std::size_t allocation_count = 0;
+
+// GCC sees free() being called on memory from operator new wherever these
+// are inlined, and warns that the two don't match. They do match here, since
+// both are replaced, so the warning is suppressed for the replacements.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+  ++allocation_count;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+//------------------------------------------------------------------------------
+
 namespace {
 
 //------------------------------------------------------------------------------
 
+// An executor which queues closures until they are explicitly run.
+class queue_executor
+{
+public:
+  void submit(std::function<void()> closure)
+  {
+    closures.push_back(std::move(closure));
+  }
+
+  std::size_t run()
+  {
+    std::size_t count = 0;
+    while (!closures.empty())
+    {
+      auto closure = std::move(closures.front());
+      closures.pop_front();
+      closure();
+      ++count;
+    }
+    return count;
+  }
+
+private:
+  std::deque<std::function<void()>> closures;
+};
+
+//------------------------------------------------------------------------------
+
 // Check that a single slot can connect to and receive a signal with no
 // arguments.
 TEST(signals_test, slot_receives_void_signal)
@@ -232,6 +314,2083 @@ TEST(signals_test, function_connected_to_signal_is_not_leaked)
   EXPECT_TRUE(called.expired());
 }
 
+// Check that a function connected directly to a signal can be disconnected
+// through the returned handle, which destroys the function.
+TEST(signals_test, function_connection_disconnects)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  auto alive = std::make_shared<bool>(true);
+  std::weak_ptr<bool> weak_alive{alive};
+
+  bb::connection connection = bb::connect(signal,
+    [&received, alive = std::move(alive)]{ ++received; });
+  EXPECT_TRUE(connection.connected());
+
+  emit_signal();
+  EXPECT_EQ(1, received);
+
+  bb::connection copy = connection;
+  connection.disconnect();
+  EXPECT_FALSE(connection.connected());
+  EXPECT_FALSE(copy.connected());
+  EXPECT_TRUE(weak_alive.expired());
+
+  emit_signal();
+  EXPECT_EQ(1, received);
+
+  // Disconnecting again does nothing.
+  copy.disconnect();
+  EXPECT_FALSE(bb::connection{}.connected());
+}
+
+// Check that a function can disconnect itself, and that slots can destroy
+// themselves, from within their own invocation.
+TEST(signals_test, disconnect_from_within)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  bb::connection once;
+  once = bb::connect(signal, [&](int value)
+  {
+    received += value;
+    once.disconnect();
+  });
+
+  std::unique_ptr<bb::slot<int>> reentrant;
+  reentrant = std::make_unique<bb::slot<int>>(bb::reentrant, [&](int value)
+  {
+    received += 10 * value;
+    reentrant.reset();
+  });
+  bb::connect(signal, *reentrant);
+
+  bb::basic_emitter<bb::single_threaded, int> emit_local;
+  bb::basic_signal<bb::single_threaded, int> local;
+  bb::connect(emit_local, local);
+  bb::connection local_once;
+  local_once = bb::connect(local, [&](int value)
+  {
+    received += 100 * value;
+    local_once.disconnect();
+  });
+
+  emit_signal(1);
+  emit_local(1);
+  EXPECT_FALSE(once.connected());
+  EXPECT_FALSE(reentrant);
+  EXPECT_FALSE(local_once.connected());
+  EXPECT_EQ(111, received);
+
+  emit_signal(1);
+  emit_local(1);
+  EXPECT_EQ(111, received);
+}
+
+// Check that many short-lived connections can be made and disconnected
+// without disturbing the long-lived ones.
+TEST(signals_test, connection_churn)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  int total = 0;
+  bb::slot<int> slot{[&](int value){ total += value; }};
+  bb::connect(signal, slot);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    int received = 0;
+    auto connection = bb::connect(signal, [&](int){ ++received; });
+    emit_signal(1);
+    connection.disconnect();
+    EXPECT_EQ(1, received);
+  }
+
+  emit_signal(1);
+  EXPECT_EQ(1001, total);
+}
+
+// Check that slots keep receiving signals in connection order when slots
+// around them are destroyed.
+TEST(signals_test, slots_are_called_in_connection_order)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> calls;
+  vector<bb::slot<>> slots_;
+
+  for (int i = 0; i < 10; ++i)
+  {
+    bb::slot<> slot{[&calls, i]{ calls.push_back(i); }};
+    bb::connect(signal, slot);
+    slots_.push_back(std::move(slot));
+  }
+
+  for (int i = 0; i < 10; i += 2)
+    slots_[i] = bb::slot<>{};
+
+  emit_signal();
+  EXPECT_EQ((vector<int>{1, 3, 5, 7, 9}), calls);
+
+  calls.clear();
+  slots_[5] = bb::slot<>{};
+
+  emit_signal();
+  EXPECT_EQ((vector<int>{1, 3, 7, 9}), calls);
+}
+
+// Check that connecting an empty slot is harmless.
+TEST(signals_test, empty_slot_connects_to_signal)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  bb::slot<> slot;
+  bb::connect(signal, slot);
+
+  emit_signal();
+}
+
+// Check that a slot with an executor is invoked when the executor runs the
+// submitted closure, rather than when the signal is emitted.
+TEST(signals_test, executor_slot_receives_signal)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  vector<int> received;
+  bb::slot<int> slot{executor, [&](int value){ received.push_back(value); }};
+  bb::connect(signal, slot);
+
+  emit_signal(1);
+  emit_signal(2);
+  EXPECT_TRUE(received.empty());
+
+  EXPECT_EQ(2u, executor.run());
+  EXPECT_EQ((vector<int>{1, 2}), received);
+
+  // Closures which are still queued when the slot is destroyed do nothing.
+  emit_signal(3);
+  slot = bb::slot<int>{};
+  EXPECT_EQ(1u, executor.run());
+  EXPECT_EQ((vector<int>{1, 2}), received);
+}
+
+// Check that emitting to inline slots doesn't allocate.
+TEST(signals_test, inline_emit_does_not_allocate)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  int total = 0;
+  vector<bb::slot<int>> slots_;
+  for (int i = 0; i < 10; ++i)
+  {
+    bb::slot<int> slot{[&](int value){ total += value; }};
+    bb::connect(signal, slot);
+    slots_.push_back(std::move(slot));
+  }
+
+  // The first emit on a thread may register it for reclamation.
+  emit_signal(1);
+
+  std::size_t before = allocation_count;
+  for (int i = 0; i < 100; ++i)
+    emit_signal(1);
+
+  EXPECT_EQ(before, allocation_count);
+  EXPECT_EQ(1010, total);
+}
+
+// Check that the callable is stored within the slot, so that constructing a
+// slot only allocates its shared state.
+TEST(signals_test, slot_function_does_not_allocate)
+{
+  std::array<int, 8> captured = {};
+  std::size_t before = allocation_count;
+  bb::slot<int> slot{[captured](int value){ (void)captured; (void)value; }};
+  EXPECT_EQ(before + 1, allocation_count);
+}
+
+// Check that a slot can be bound directly to a member function.
+TEST(signals_test, slot_binds_member_function)
+{
+  struct receiver
+  {
+    void on_value(int value) { values.push_back(value); }
+    int total() const { return std::accumulate(values.begin(), values.end(), 0); }
+    vector<int> values;
+  };
+
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  receiver r;
+  using function_t = bb::slot<int>::function_t;
+  bb::slot<int> slot{function_t::bind<receiver, &receiver::on_value>(r)};
+  bb::connect(signal, slot);
+
+  emit_signal(1);
+  emit_signal(2);
+  EXPECT_EQ((vector<int>{1, 2}), r.values);
+
+  auto total = bb::inplace_function<int()>::bind<receiver, &receiver::total>(r);
+  EXPECT_EQ(3, total());
+}
+
+// Check the copy, move and empty semantics of inplace_function.
+TEST(signals_test, inplace_function_semantics)
+{
+  auto counter = std::make_shared<int>(0);
+  bb::inplace_function<int(int)> fn{[counter](int value)
+  {
+    return *counter += value;
+  }};
+
+  ASSERT_TRUE(static_cast<bool>(fn));
+  EXPECT_EQ(2u, counter.use_count());
+
+  bb::inplace_function<int(int)> copy{fn};
+  EXPECT_EQ(3u, counter.use_count());
+  EXPECT_EQ(1, copy(1));
+  EXPECT_EQ(3, fn(2));
+
+  bb::inplace_function<int(int)> moved{std::move(copy)};
+  EXPECT_FALSE(static_cast<bool>(copy));
+  EXPECT_EQ(3u, counter.use_count());
+  EXPECT_EQ(4, moved(1));
+
+  moved = nullptr;
+  fn = nullptr;
+  EXPECT_EQ(1u, counter.use_count());
+  EXPECT_THROW(fn(1), std::bad_function_call);
+}
+
+// Check that null function pointers and empty std::functions make empty
+// functions, and that connecting them to a slot does nothing when emitted.
+TEST(signals_test, inplace_function_from_null_callables)
+{
+  void (*null_pointer)(int) = nullptr;
+  std::function<void(int)> empty_function;
+
+  EXPECT_FALSE(static_cast<bool>(bb::inplace_function<void(int)>{null_pointer}));
+  EXPECT_FALSE(static_cast<bool>(
+    bb::inplace_function<void(int)>{empty_function}));
+
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  bb::slot<int> pointer_slot{null_pointer};
+  bb::slot<int> function_slot{empty_function};
+  bb::connect(signal, pointer_slot);
+  bb::connect(signal, function_slot);
+  bb::connect(signal, null_pointer);
+  bb::connect(signal, empty_function);
+
+  EXPECT_NO_THROW(emit_signal(1));
+}
+
+// Check that callables which are too large, or which may throw when moved,
+// are stored on the heap, and still copy and move correctly.
+TEST(signals_test, inplace_function_stores_large_callables_on_heap)
+{
+  struct throwing_move
+  {
+    throwing_move() = default;
+    throwing_move(const throwing_move&) = default;
+    throwing_move(throwing_move&&) noexcept(false) = default;
+    int operator()(int value) const { return value + 1; }
+  };
+
+  std::array<int, 32> large;
+  large.fill(1);
+  auto sum = [large](int value)
+  {
+    return std::accumulate(large.begin(), large.end(), value);
+  };
+
+  bb::inplace_function<int(int)> fn{sum};
+  bb::inplace_function<int(int)> copy{fn};
+  bb::inplace_function<int(int)> moved{std::move(fn)};
+  EXPECT_FALSE(static_cast<bool>(fn));
+  EXPECT_EQ(33, copy(1));
+  EXPECT_EQ(34, moved(2));
+
+  bb::inplace_function<int(int)> throwing{throwing_move{}};
+  copy = std::move(throwing);
+  EXPECT_EQ(2, copy(1));
+
+  static_assert(std::is_nothrow_move_constructible<
+                  bb::inplace_function<int(int)>>::value,
+                "moving an inplace_function mustn't throw");
+}
+
+// Check that a batch of signals is delivered to ordinary slots one at a time,
+// in order.
+TEST(signals_test, slot_receives_batch)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> received;
+  bb::slot<int> slot{[&](int value){ received.push_back(value); }};
+  bb::connect(signal, slot);
+
+  emit_signal.emit_batch(vector<int>{1, 2, 3});
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+}
+
+// Check that a batch of signals with several parameters is given as a range
+// of tuples.
+TEST(signals_test, slot_receives_batch_of_tuples)
+{
+  bb::emitter<int, int> emit_signal;
+  bb::signal<int, int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> received;
+  bb::slot<int, int> slot{[&](int a, int b){ received.push_back(a * b); }};
+  bb::connect(signal, slot);
+
+  std::array<std::tuple<int, int>, 2> events = {{
+    std::make_tuple(2, 3), std::make_tuple(4, 5)
+  }};
+  emit_signal.emit_batch(events);
+  EXPECT_EQ((vector<int>{6, 20}), received);
+}
+
+// Check that a batch-aware slot receives a whole batch in one call, and that
+// single signals are delivered as a batch of one.
+TEST(signals_test, batch_slot_receives_batch)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<vector<int>> received;
+  bb::slot<int> slot{bb::batched, [&](const bb::batch<int>& events)
+  {
+    vector<int> values;
+    for (const auto& event : events)
+      values.push_back(std::get<0>(event));
+    received.push_back(values);
+  }};
+  bb::connect(signal, slot);
+
+  emit_signal.emit_batch(vector<int>{1, 2, 3});
+  emit_signal(4);
+
+  EXPECT_EQ((vector<vector<int>>{{1, 2, 3}, {4}}), received);
+}
+
+// Check that a batch submits a single closure to the executor of each slot.
+TEST(signals_test, executor_slot_receives_batch)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  vector<int> received;
+  std::size_t batch_size = 0;
+
+  bb::slot<int> slot{executor, [&](int value){ received.push_back(value); }};
+  bb::connect(signal, slot);
+
+  bb::slot<int> batch_slot{bb::batched, executor,
+                           [&](const bb::batch<int>& events)
+  {
+    batch_size = events.size();
+  }};
+  bb::connect(signal, batch_slot);
+
+  emit_signal.emit_batch(vector<int>{1, 2, 3});
+  EXPECT_TRUE(received.empty());
+
+  EXPECT_EQ(2u, executor.run());
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+  EXPECT_EQ(3u, batch_size);
+}
+
+// Check that a reentrant slot can be invoked by several threads at once.
+TEST(signals_test, reentrant_slot_runs_concurrently)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  // Each invocation waits for the other to start, which would never happen
+  // if the invocations were serialized.
+  std::atomic<int> entered{0};
+  std::atomic<bool> timed_out{false};
+  bb::slot<> slot{bb::reentrant, [&]
+  {
+    ++entered;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (entered < 2)
+    {
+      if (std::chrono::steady_clock::now() > deadline)
+      {
+        timed_out = true;
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }};
+  bb::connect(signal, slot);
+
+  std::thread first([&]{ emit_signal(); });
+  std::thread second([&]{ emit_signal(); });
+  first.join();
+  second.join();
+
+  EXPECT_EQ(2, entered.load());
+  EXPECT_FALSE(timed_out.load());
+}
+
+// Check that destroying a reentrant slot waits for invocations in progress.
+TEST(signals_test, reentrant_slot_destructor_waits)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  std::atomic<bool> finished{false};
+  std::atomic<bool> destroyed{false};
+
+  auto slot = std::make_unique<bb::slot<>>(bb::reentrant, [&]
+  {
+    entered = true;
+    while (!release)
+      std::this_thread::yield();
+    finished = true;
+  });
+  bb::connect(signal, *slot);
+
+  std::thread emitting([&]{ emit_signal(); });
+  while (!entered)
+    std::this_thread::yield();
+
+  std::thread destroying([&]
+  {
+    slot.reset();
+    destroyed = true;
+    EXPECT_TRUE(finished.load());
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(destroyed.load());
+
+  release = true;
+  emitting.join();
+  destroying.join();
+  EXPECT_TRUE(destroyed.load());
+
+  // The slot is disconnected once it has been destroyed.
+  finished = false;
+  emit_signal();
+  EXPECT_FALSE(finished.load());
+}
+
+// A type which counts how many times it has been copied.
+struct copy_counter
+{
+  copy_counter() = default;
+  copy_counter(const copy_counter& other) : copies{other.copies} { ++*copies; }
+  copy_counter(copy_counter&&) = default;
+  copy_counter& operator=(const copy_counter&) = delete;
+  copy_counter& operator=(copy_counter&&) = default;
+
+  std::shared_ptr<int> copies = std::make_shared<int>(0);
+};
+
+// Check that signals which take their argument by reference pass it to every
+// slot without copying it.
+TEST(signals_test, reference_arguments_are_not_copied)
+{
+  bb::emitter<const copy_counter&> emit_signal;
+  bb::signal<const copy_counter&> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  vector<bb::slot<const copy_counter&>> slots_;
+  for (int i = 0; i < 3; ++i)
+  {
+    bb::slot<const copy_counter&> slot{[&](const copy_counter&){ ++received; }};
+    bb::connect(signal, slot);
+    slots_.push_back(std::move(slot));
+  }
+
+  copy_counter value;
+  emit_signal(value);
+
+  EXPECT_EQ(3, received);
+  EXPECT_EQ(0, *value.copies);
+}
+
+// Check that slots which take an rvalue argument by value copy it, except for
+// the last, which takes ownership of it.
+TEST(signals_test, arguments_are_copied_to_all_but_last_slot)
+{
+  bb::emitter<copy_counter> emit_signal;
+  bb::signal<copy_counter> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<bb::slot<copy_counter>> slots_;
+  for (int i = 0; i < 3; ++i)
+  {
+    bb::slot<copy_counter> slot{[](copy_counter){}};
+    bb::connect(signal, slot);
+    slots_.push_back(std::move(slot));
+  }
+
+  copy_counter value;
+  auto copies = value.copies;
+  emit_signal(std::move(value));
+  EXPECT_EQ(2, *copies);
+
+  // The last slot is the last one which is still connected.
+  slots_.pop_back();
+  *copies = 0;
+  copy_counter other{};
+  other.copies = copies;
+  emit_signal(std::move(other));
+  EXPECT_EQ(1, *copies);
+}
+
+// Check that an rvalue argument is moved into an executor's closure.
+TEST(signals_test, arguments_are_moved_into_executor)
+{
+  bb::emitter<copy_counter> emit_signal;
+  bb::signal<copy_counter> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  int received = 0;
+  bb::slot<copy_counter> slot{executor, [&](copy_counter){ ++received; }};
+  bb::connect(signal, slot);
+
+  copy_counter value;
+  auto copies = value.copies;
+  emit_signal(std::move(value));
+  executor.run();
+
+  EXPECT_EQ(1, received);
+  EXPECT_EQ(0, *copies);
+}
+
+// Check that move-only arguments can be emitted to the last connected slot,
+// both to inline slots and to slots with an executor.
+TEST(signals_test, move_only_arguments)
+{
+  bb::emitter<std::unique_ptr<int>> emit_signal;
+  bb::signal<std::unique_ptr<int>> signal;
+  bb::connect(emit_signal, signal);
+
+  std::unique_ptr<int> received;
+  {
+    bb::slot<std::unique_ptr<int>> slot{[&](std::unique_ptr<int> value)
+    {
+      received = std::move(value);
+    }};
+    bb::connect(signal, slot);
+
+    emit_signal.emit_to_last(std::make_unique<int>(1));
+    ASSERT_TRUE(received);
+    EXPECT_EQ(1, *received);
+  }
+
+  queue_executor executor;
+  bb::slot<std::unique_ptr<int>> slot{executor, [&](std::unique_ptr<int> value)
+  {
+    received = std::move(value);
+  }};
+  bb::connect(signal, slot);
+
+  emit_signal.emit_to_last(std::make_unique<int>(2));
+  executor.run();
+  ASSERT_TRUE(received);
+  EXPECT_EQ(2, *received);
+}
+
+// Check that emit_shared() copies the arguments once for any number of slots
+// with an executor, and delivers them to every kind of slot.
+TEST(signals_test, emit_shared)
+{
+  bb::emitter<const copy_counter&> emit_signal;
+  bb::signal<const copy_counter&> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  int received = 0;
+  vector<bb::slot<const copy_counter&>> slots_;
+  for (int i = 0; i < 3; ++i)
+  {
+    bb::slot<const copy_counter&> slot{executor,
+                                       [&](const copy_counter&){ ++received; }};
+    bb::connect(signal, slot);
+    slots_.push_back(std::move(slot));
+  }
+
+  bb::slot<const copy_counter&> inline_slot{
+    [&](const copy_counter&){ ++received; }};
+  bb::connect(signal, inline_slot);
+
+  bb::slot<const copy_counter&> batch_slot{bb::batched, executor,
+    [&](const bb::batch<const copy_counter&>& events)
+    {
+      received += static_cast<int>(events.size());
+    }};
+  bb::connect(signal, batch_slot);
+
+  copy_counter value;
+  emit_signal.emit_shared(value);
+  EXPECT_EQ(1, received);
+  executor.run();
+
+  EXPECT_EQ(5, received);
+  EXPECT_EQ(1, *value.copies);
+}
+
+// Check that emit_shared() doesn't materialize the arguments if no slots are
+// connected.
+TEST(signals_test, emit_shared_without_slots)
+{
+  bb::emitter<const copy_counter&> emit_signal;
+  bb::signal<const copy_counter&> signal;
+  bb::connect(emit_signal, signal);
+
+  copy_counter value;
+  emit_signal.emit_shared(value);
+  EXPECT_EQ(0, *value.copies);
+}
+
+// Check that a conflated slot only has one closure queued at a time, which
+// delivers the most recent arguments.
+TEST(signals_test, conflated_slot_receives_latest)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  vector<int> received;
+  bb::slot<int> slot{bb::conflated, executor,
+                     [&](int value){ received.push_back(value); }};
+  bb::connect(signal, slot);
+
+  for (int i = 1; i <= 5; ++i)
+    emit_signal(i);
+  EXPECT_EQ(1u, executor.run());
+  EXPECT_EQ((vector<int>{5}), received);
+
+  emit_signal(6);
+  emit_signal.emit_batch(vector<int>{7, 8, 9});
+  emit_signal.emit_shared(10);
+  emit_signal(11);
+  EXPECT_EQ(1u, executor.run());
+  EXPECT_EQ((vector<int>{5, 11}), received);
+}
+
+// Check that a conflated slot which is destroyed whilst a closure is queued
+// doesn't receive it, and releases the pending arguments.
+TEST(signals_test, conflated_slot_destroyed_with_pending_event)
+{
+  bb::emitter<std::shared_ptr<int>> emit_signal;
+  bb::signal<std::shared_ptr<int>> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  int received = 0;
+  auto slot = std::make_unique<bb::slot<std::shared_ptr<int>>>(
+    bb::conflated, executor, [&](std::shared_ptr<int>){ ++received; });
+  bb::connect(signal, *slot);
+
+  auto value = std::make_shared<int>(1);
+  emit_signal(value);
+  EXPECT_EQ(2, value.use_count());
+
+  slot.reset();
+  EXPECT_EQ(1, value.use_count());
+  executor.run();
+  EXPECT_EQ(0, received);
+}
+
+// Check that a bounded slot submits one closure to drain its mailbox, and
+// applies its overflow policy once the mailbox is full.
+TEST(signals_test, bounded_slot_overflow)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  vector<int> newest;
+  vector<int> oldest;
+  bb::slot<int> drop_newest{bb::bounded(4, bb::overflow::drop_newest),
+                            executor,
+                            [&](int value){ newest.push_back(value); }};
+  bb::slot<int> drop_oldest{bb::bounded(4, bb::overflow::drop_oldest),
+                            executor,
+                            [&](int value){ oldest.push_back(value); }};
+  bb::connect(signal, drop_newest);
+  bb::connect(signal, drop_oldest);
+
+  for (int i = 1; i <= 10; ++i)
+    emit_signal(i);
+
+  EXPECT_EQ(2u, executor.run());
+  EXPECT_EQ((vector<int>{1, 2, 3, 4}), newest);
+  EXPECT_EQ((vector<int>{7, 8, 9, 10}), oldest);
+  EXPECT_EQ(6u, drop_newest.overflow_count());
+  EXPECT_EQ(6u, drop_oldest.overflow_count());
+
+  emit_signal(11);
+  EXPECT_EQ(2u, executor.run());
+  EXPECT_EQ(11, newest.back());
+  EXPECT_EQ(11, oldest.back());
+}
+
+// Check that a bounded slot keeps exactly as many events as its capacity, even
+// one which isn't a power of two, so a capacity of one keeps only the latest.
+TEST(signals_test, bounded_slot_exact_capacity)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  queue_executor executor;
+  vector<int> latest;
+  vector<int> three;
+  bb::slot<int> latest_slot{bb::bounded(1, bb::overflow::drop_oldest),
+                            executor,
+                            [&](int value){ latest.push_back(value); }};
+  bb::slot<int> three_slot{bb::bounded(3, bb::overflow::drop_newest),
+                           executor,
+                           [&](int value){ three.push_back(value); }};
+  bb::connect(signal, latest_slot);
+  bb::connect(signal, three_slot);
+
+  for (int i = 1; i <= 5; ++i)
+    emit_signal(i);
+
+  executor.run();
+  EXPECT_EQ((vector<int>{5}), latest);
+  EXPECT_EQ((vector<int>{1, 2, 3}), three);
+  EXPECT_EQ(4u, latest_slot.overflow_count());
+  EXPECT_EQ(2u, three_slot.overflow_count());
+}
+
+// Check that a bounded slot which blocks its emitter delivers every event in
+// order.
+TEST(signals_test, bounded_slot_blocks)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> received;
+  bb::slot<int> slot;
+
+  {
+    bb::thread_pool_executor pool{1};
+    slot = bb::slot<int>{bb::bounded(2), pool,
+                         [&](int value){ received.push_back(value); }};
+    bb::connect(signal, slot);
+
+    for (int i = 0; i < 1000; ++i)
+      emit_signal(i);
+  }
+
+  vector<int> expected(1000);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(expected, received);
+}
+
+// Check that a slot can connect another slot to the signal which is currently
+// being emitted, and that the new slot receives subsequent emissions.
+TEST(signals_test, slot_connects_during_emit)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  bb::slot<> inner{[&]{ ++received; }};
+  bb::slot<> outer{[&]{ bb::connect(signal, inner); }};
+  bb::connect(signal, outer);
+
+  emit_signal();
+  EXPECT_EQ(0, received);
+
+  emit_signal();
+  EXPECT_EQ(1, received);
+}
+
+// Check that single-threaded signals deliver to their slots, including slots
+// which connect or disconnect others during an emit.
+TEST(signals_test, single_threaded_signal)
+{
+  bb::basic_emitter<bb::single_threaded, int> emit_signal;
+  bb::basic_signal<bb::single_threaded, int> signal;
+  bb::connect(emit_signal, signal);
+
+  int total = 0;
+  bb::basic_slot<bb::single_threaded, int> inner{
+    [&](int value){ total += value; }};
+  std::unique_ptr<bb::basic_slot<bb::single_threaded, int>> once;
+
+  bb::basic_slot<bb::single_threaded, int> outer{[&](int)
+  {
+    if (once)
+      bb::connect(signal, inner);
+    once.reset();
+  }};
+  bb::connect(signal, outer);
+
+  once = std::make_unique<bb::basic_slot<bb::single_threaded, int>>(
+    [&](int value){ total += 100 * value; });
+  bb::connect(signal, *once);
+
+  emit_signal(1);
+  EXPECT_EQ(0, total);
+
+  emit_signal(2);
+  EXPECT_EQ(2, total);
+
+  bb::connect(signal, [&](int value){ total += 10 * value; });
+  emit_signal(3);
+  EXPECT_EQ(35, total);
+}
+
+// Check that a slot can destroy a single-threaded signal during an emit, and
+// that the state outlives the emit.
+TEST(signals_test, single_threaded_signal_destroyed_during_emit)
+{
+  bb::basic_emitter<bb::single_threaded, int> emit_signal;
+  auto signal = make_unique<bb::basic_signal<bb::single_threaded, int>>();
+  bb::connect(emit_signal, *signal);
+
+  int received = 0;
+  bb::connect(*signal, [&](int){ signal.reset(); });
+  bb::connect(*signal, [&](int value){ received += value; });
+
+  emit_signal(1);
+  EXPECT_FALSE(signal);
+  EXPECT_EQ(1, received);
+
+  emit_signal(2);
+  EXPECT_EQ(1, received);
+}
+
+// Check that a single-threaded emit doesn't allocate either.
+TEST(signals_test, single_threaded_emit_does_not_allocate)
+{
+  bb::basic_emitter<bb::single_threaded, int> emit_signal;
+  bb::basic_signal<bb::single_threaded, int> signal;
+  bb::connect(emit_signal, signal);
+
+  int total = 0;
+  bb::basic_slot<bb::single_threaded, int> slot{[&](int value)
+  {
+    total += value;
+  }};
+  bb::connect(signal, slot);
+
+  std::size_t before = allocation_count;
+  for (int i = 0; i < 100; ++i)
+    emit_signal(1);
+
+  EXPECT_EQ(before, allocation_count);
+  EXPECT_EQ(100, total);
+}
+
+// Check that emitting from several threads at once, whilst slots are being
+// connected and destroyed, delivers every emission to the persistent slots.
+TEST(signals_test, concurrent_emit_and_connect)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  std::atomic<int> total{0};
+  bb::slot<int> slot{[&](int value){ total += value; }};
+  bb::connect(signal, slot);
+
+  const int thread_count = 4;
+  const int emit_count = 10000;
+  std::atomic<bool> done{false};
+
+  std::thread churn([&]
+  {
+    while (!done)
+    {
+      bb::slot<int> transient{[](int){}};
+      bb::connect(signal, transient);
+    }
+  });
+
+  std::vector<std::thread> emitters;
+  for (int i = 0; i < thread_count; ++i)
+  {
+    emitters.emplace_back([&]
+    {
+      for (int j = 0; j < emit_count; ++j)
+        emit_signal(1);
+    });
+  }
+
+  for (auto& thread : emitters)
+    thread.join();
+
+  done = true;
+  churn.join();
+
+  EXPECT_EQ(thread_count * emit_count, total.load());
+}
+
+// Check that the thread pool runs every closure submitted to it before it's
+// destroyed.
+TEST(signals_test, thread_pool_executor)
+{
+  std::atomic<int> count{0};
+
+  {
+    bb::thread_pool_executor pool{4};
+    EXPECT_EQ(4u, pool.size());
+
+    for (int i = 0; i < 10000; ++i)
+      pool.submit([&]{ count.fetch_add(1, std::memory_order_relaxed); });
+  }
+
+  EXPECT_EQ(10000, count.load());
+}
+
+// Check that closures which submit further closures from the workers' own
+// threads are all run.
+TEST(signals_test, thread_pool_executor_nested_submit)
+{
+  std::atomic<int> count{0};
+  std::function<void(int)> spawn;
+
+  {
+    bb::thread_pool_executor pool{4};
+
+    spawn = [&](int depth)
+    {
+      count.fetch_add(1, std::memory_order_relaxed);
+      if (depth == 0)
+        return;
+
+      for (int i = 0; i < 4; ++i)
+        pool.submit([&spawn, depth]{ spawn(depth - 1); });
+    };
+
+    pool.submit([&]{ spawn(6); });
+  }
+
+  // 1 + 4 + 4^2 + ... + 4^6
+  EXPECT_EQ(5461, count.load());
+}
+
+// Check that the thread pool can be used as a slot's executor.
+TEST(signals_test, thread_pool_executor_slots)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  std::atomic<int> total{0};
+  vector<bb::slot<int>> slots_;
+
+  {
+    bb::thread_pool_executor pool{4};
+
+    for (int i = 0; i < 8; ++i)
+    {
+      bb::slot<int> slot{pool, [&](int value){ total.fetch_add(value); }};
+      bb::connect(signal, slot);
+      slots_.push_back(std::move(slot));
+    }
+
+    for (int i = 1; i <= 100; ++i)
+      emit_signal(i);
+  }
+
+  EXPECT_EQ(8 * 5050, total.load());
+}
+
+// Check that posting to a slot on the thread pool allocates only the pool's
+// task, rather than wrapping the closure again.
+TEST(signals_test, thread_pool_executor_slot_allocates_once)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  std::atomic<int> total{0};
+  bb::thread_pool_executor pool{1};
+  bb::slot<int> slot{pool, [&](int value){ total.fetch_add(value); }};
+  bb::connect(signal, slot);
+
+  emit_signal(1);
+  std::size_t before = allocation_count;
+  emit_signal(2);
+  EXPECT_EQ(before + 1, allocation_count);
+
+  while (total.load() != 3)
+    this_thread::yield();
+}
+
+// A static slot which records the values it receives.
+struct recording_slot
+{
+  void operator()(int value)
+  {
+    received.push_back(value);
+  }
+
+  vector<int> received;
+};
+
+// Check that a static signal invokes each of its slots in order.
+TEST(signals_test, static_signal)
+{
+  vector<int> order;
+  auto first = [&](int value){ order.push_back(value); };
+  auto second = [&](int value){ order.push_back(value * 10); };
+
+  bb::static_emitter<decltype(first), decltype(second), recording_slot> emit;
+  bb::static_signal<decltype(first), decltype(second), recording_slot> signal{
+    first, second, recording_slot{}};
+
+  // Emitting before connecting does nothing.
+  emit(1);
+  EXPECT_TRUE(order.empty());
+
+  bb::connect(emit, signal);
+  auto copy = emit;
+  emit(2);
+  copy(3);
+  EXPECT_EQ((vector<int>{2, 20, 3, 30}), order);
+  EXPECT_EQ((vector<int>{2, 3}), signal.slot<2>().received);
+}
+
+// Check that a static signal without slots can be constructed and emitted.
+TEST(signals_test, static_signal_without_slots)
+{
+  bb::static_emitter<> emit;
+  bb::static_signal<> signal{};
+  bb::connect(emit, signal);
+  emit();
+}
+
+// Check that a static signal moves rvalue arguments into its last slot only,
+// and doesn't allocate.
+TEST(signals_test, static_signal_arguments)
+{
+  int copies = 0;
+  std::unique_ptr<int> moved;
+  auto by_reference = [&](const std::unique_ptr<int>& p){ copies += *p; };
+  auto by_value = [&](std::unique_ptr<int> p){ moved = std::move(p); };
+
+  bb::static_emitter<decltype(by_reference), decltype(by_value)> emit;
+  bb::static_signal<decltype(by_reference), decltype(by_value)> signal{
+    by_reference, by_value};
+  bb::connect(emit, signal);
+
+  auto value = std::make_unique<int>(1);
+  auto before = allocation_count;
+  emit(std::move(value));
+  EXPECT_EQ(before, allocation_count);
+
+  EXPECT_EQ(1, copies);
+  ASSERT_TRUE(moved);
+  EXPECT_EQ(1, *moved);
+}
+
+// Check that slots are invoked in priority order, and in connection order
+// within a priority, including after the table has been compacted.
+TEST(signals_test, slot_priority)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> order;
+  bb::slot<> low{[&]{ order.push_back(1); }};
+  bb::slot<> normal{[&]{ order.push_back(2); }};
+  auto high = std::make_unique<bb::slot<>>([&]{ order.push_back(3); });
+  bb::slot<> high_later{[&]{ order.push_back(4); }};
+
+  bb::connect(signal, low, bb::priority{-5});
+  bb::connect(signal, normal);
+  bb::connect(signal, *high, bb::priority{10});
+  bb::connect(signal, high_later, bb::priority{10});
+  auto function = bb::connect(signal, [&]{ order.push_back(5); },
+                              bb::priority{5});
+
+  emit_signal();
+  EXPECT_EQ((vector<int>{3, 4, 5, 2, 1}), order);
+
+  order.clear();
+  high.reset();
+  emit_signal();
+  bb::slot<> highest{[&]{ order.push_back(6); }};
+  bb::connect(signal, highest, bb::priority{20});
+  emit_signal();
+  EXPECT_EQ((vector<int>{4, 5, 2, 1, 6, 4, 5, 2, 1}), order);
+}
+
+// Check that a short-circuiting slot stops an emit from reaching the slots
+// after it once it has handled the event.
+TEST(signals_test, short_circuit_slot)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> handled;
+  vector<int> received;
+  bb::slot<int> handler{bb::short_circuit, [&](int value)
+  {
+    if (value % 2 != 0)
+      return false;
+    handled.push_back(value);
+    return true;
+  }};
+  bb::slot<int> observer{[&](int value){ received.push_back(value); }};
+
+  bb::connect(signal, observer);
+  bb::connect(signal, handler, bb::priority{1});
+
+  emit_signal(1);
+  emit_signal(2);
+  emit_signal.emit_shared(3);
+  emit_signal.emit_shared(4);
+  EXPECT_EQ((vector<int>{2, 4}), handled);
+  EXPECT_EQ((vector<int>{1, 3}), received);
+
+  // Batches aren't short-circuited.
+  emit_signal.emit_batch(vector<int>{5, 6});
+  EXPECT_EQ((vector<int>{2, 4, 6}), handled);
+  EXPECT_EQ((vector<int>{1, 3, 5, 6}), received);
+}
+
+// Check that the results of a signal's slots are combined in priority order.
+TEST(signals_test, result_signal_combiners)
+{
+  bb::emitter<int(int)> emit_signal;
+  bb::signal<int(int)> signal;
+  bb::connect(emit_signal, signal);
+
+  // Nothing is connected yet, so each combiner produces its initial result.
+  EXPECT_EQ(-1, emit_signal.combine(bb::combiners::last<int>{-1}, 1));
+  EXPECT_TRUE(emit_signal.combine(bb::combiners::vector<int>{}, 1).empty());
+
+  bb::slot<int(int)> doubled{[](int value){ return value * 2; }};
+  bb::slot<int(int)> squared{[](int value){ return value * value; }};
+  bb::connect(signal, doubled);
+  bb::connect(signal, squared, bb::priority{1});
+  auto incremented = bb::connect(signal, [](int value){ return value + 1; },
+                                 bb::priority{-1});
+
+  EXPECT_EQ((vector<int>{9, 6, 4}),
+            emit_signal.combine(bb::combiners::vector<int>{}, 3));
+  EXPECT_EQ(4, emit_signal.combine(bb::combiners::last<int>{}, 3));
+  EXPECT_EQ(9, emit_signal.combine(bb::combiners::first<int>{}, 3));
+  EXPECT_EQ(19, emit_signal.combine(
+    bb::combiners::fold(0, [](int sum, int value){ return sum + value; }), 3));
+
+  incremented.disconnect();
+  EXPECT_EQ((vector<int>{9, 6}),
+            emit_signal.combine(bb::combiners::vector<int>{}, 3));
+}
+
+// Check that a combiner can stop an emit early, and that combining doesn't
+// allocate.
+TEST(signals_test, result_signal_early_exit)
+{
+  bb::emitter<bool(const string&)> emit_signal;
+  bb::signal<bool(const string&)> signal;
+  bb::connect(emit_signal, signal);
+
+  int invocations = 0;
+  auto vote = [&](bool result)
+  {
+    return [&invocations, result](const string&)
+    {
+      ++invocations;
+      return result;
+    };
+  };
+
+  bb::slot<bool(const string&)> no{vote(false)};
+  bb::slot<bool(const string&)> yes{vote(true)};
+  bb::slot<bool(const string&)> late{vote(true)};
+  bb::connect(signal, no);
+  bb::connect(signal, yes);
+  bb::connect(signal, late);
+
+  const string motion{"motion"};
+  auto before = allocation_count;
+  EXPECT_TRUE(emit_signal.combine(bb::combiners::any_of{}, motion));
+  EXPECT_EQ(before, allocation_count);
+  EXPECT_EQ(2, invocations);
+
+  invocations = 0;
+  EXPECT_FALSE(emit_signal.combine(bb::combiners::first<bool>{}, motion));
+  EXPECT_EQ(1, invocations);
+}
+
+// A resource which counts its outstanding allocations. It allocates with
+// malloc(), so that they aren't counted as heap allocations too, and so only
+// supports fundamental alignments.
+class counting_resource : public bb::memory_resource
+{
+public:
+  std::size_t allocations = 0;
+  std::size_t outstanding = 0;
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    EXPECT_LE(alignment, alignof(std::max_align_t));
+    ++allocations;
+    ++outstanding;
+    if (void* p = std::malloc(bytes ? bytes : 1))
+      return p;
+    throw std::bad_alloc{};
+  }
+
+  void do_deallocate(void* p, std::size_t, std::size_t) override
+  {
+    --outstanding;
+    std::free(p);
+  }
+
+  bool do_is_equal(const bb::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+// Check that signal, slot and connection state is allocated from the given
+// resource, and all of it is returned.
+TEST(signals_test, memory_resource_connections)
+{
+  counting_resource resource;
+  queue_executor executor;
+  int received = 0;
+
+  {
+    bb::emitter<int> emit_signal;
+    bb::signal<int> signal;
+    bb::connect(allocator_arg, resource, emit_signal, signal);
+    auto connected = resource.allocations;
+    EXPECT_NE(0u, connected);
+
+    bb::slot<int> slot{allocator_arg, resource,
+                       [&](int value){ received += value; }};
+    bb::slot<int> executor_slot{allocator_arg, resource, executor,
+                                [&](int value){ received += value; }};
+    bb::connect(signal, slot);
+    bb::connect(signal, executor_slot);
+    auto connection = bb::connect(signal, [&](int value){ received += value; });
+    EXPECT_LT(connected + 2, resource.allocations);
+
+    emit_signal(1);
+    executor.run();
+    EXPECT_EQ(3, received);
+
+    connection.disconnect();
+  }
+
+  EXPECT_EQ(0u, resource.outstanding);
+}
+
+// Check that the parts of slot and connection state which are allocated
+// separately, such as a conflated slot's latest event, a bounded slot's
+// mailbox, a joined signal's state and a group's state, come from the
+// resource too.
+TEST(signals_test, memory_resource_auxiliary_state)
+{
+  counting_resource resource;
+  queue_executor executor;
+  int received = 0;
+
+  {
+    bb::emitter<int> emit_first;
+    bb::emitter<int> emit_second;
+    bb::signal<int> first;
+    bb::signal<int> second;
+    bb::connect(allocator_arg, resource, emit_first, first);
+    emit_first(0);
+
+    auto before = allocation_count;
+    bb::connect(allocator_arg, resource, emit_second, second, bb::join);
+
+    bb::slot<int> conflated{allocator_arg, resource, bb::conflated, executor,
+                            [&](int value){ received += value; }};
+    bb::slot<int> bounded{allocator_arg, resource, bb::bounded(4), executor,
+                          [&](int value){ received += value; }};
+    bb::connect(first, conflated);
+    bb::connect(second, conflated);
+    bb::connect(first, bounded);
+
+    bb::connection_group group{allocator_arg, resource};
+    bb::connect(first, [&](int value){ received += value; }, group);
+    EXPECT_EQ(before, allocation_count);
+
+    emit_first(1);
+    emit_second(2);
+    executor.run();
+    EXPECT_EQ(4, received);
+  }
+
+  EXPECT_EQ(0u, resource.outstanding);
+}
+
+// Check that disconnecting enough of a signal's slots compacts it, releasing
+// their states, even if the signal is never emitted again.
+TEST(signals_test, disconnect_compacts)
+{
+  counting_resource resource;
+  bb::signal<int> signal;
+  bb::emitter<int> emit_signal;
+  bb::connect(emit_signal, signal);
+
+  std::deque<bb::slot<int>> slots;
+  for (int i = 0; i < 8; ++i)
+  {
+    slots.emplace_back(allocator_arg, resource, [](int){ });
+    bb::connect(signal, slots.back());
+  }
+  EXPECT_EQ(8u, resource.outstanding);
+
+  // A single disconnection isn't enough to compact.
+  slots.pop_front();
+  EXPECT_EQ(8u, resource.outstanding);
+
+  slots.pop_front();
+  EXPECT_EQ(6u, resource.outstanding);
+
+  slots.clear();
+  EXPECT_EQ(0u, resource.outstanding);
+}
+
+// Check that a slot which blocks during an emit doesn't stop other signals
+// releasing the slots disconnected from them.
+TEST(signals_test, blocked_slot_only_holds_back_its_signal)
+{
+  bb::emitter<> emit_blocked;
+  bb::signal<> blocked;
+  bb::connect(emit_blocked, blocked);
+
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  bb::slot<> blocker{[&]
+  {
+    entered = true;
+    while (!release)
+      std::this_thread::yield();
+  }};
+  bb::connect(blocked, blocker);
+
+  std::thread emitting([&]{ emit_blocked(); });
+  while (!entered)
+    std::this_thread::yield();
+
+  counting_resource resource;
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(allocator_arg, resource, emit_signal, signal);
+  emit_signal(1);
+  auto connected = resource.outstanding;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    bb::slot<int> slot{allocator_arg, resource, [](int){ }};
+    bb::connect(signal, slot);
+    emit_signal(1);
+  }
+  EXPECT_GE(connected + 4, resource.outstanding);
+
+  release = true;
+  emitting.join();
+}
+
+// Check that slots connected and disconnected through an arena don't touch
+// the heap once the arena has warmed up.
+TEST(signals_test, arena_connections_do_not_allocate)
+{
+  bb::arena arena;
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(allocator_arg, arena, emit_signal, signal);
+
+  int received = 0;
+  auto connect_disconnect = [&]
+  {
+    bb::slot<int> slot{allocator_arg, arena,
+                       [&](int value){ received += value; }};
+    bb::connect(signal, slot);
+    emit_signal(1);
+  };
+
+  connect_disconnect();
+  auto reserved = arena.reserved();
+  auto before = allocation_count;
+  for (int i = 0; i < 100; ++i)
+    connect_disconnect();
+  EXPECT_EQ(before, allocation_count);
+  EXPECT_EQ(reserved, arena.reserved());
+  EXPECT_EQ(101, received);
+}
+
+// Check that an arena recycles blocks by size, and passes large blocks
+// through to its upstream resource.
+TEST(signals_test, arena_recycles_blocks)
+{
+  counting_resource upstream;
+  {
+    bb::arena arena{0, &upstream};
+    void* small = arena.allocate(24);
+    EXPECT_EQ(1u, upstream.allocations);
+    arena.deallocate(small, 24);
+    EXPECT_EQ(small, arena.allocate(32));
+
+    void* large = arena.allocate(100000);
+    EXPECT_EQ(2u, upstream.allocations);
+    arena.deallocate(large, 100000);
+    EXPECT_EQ(1u, upstream.outstanding);
+  }
+  EXPECT_EQ(0u, upstream.outstanding);
+}
+
+// Check that several emitters can be joined to one signal, and share its
+// connections.
+TEST(signals_test, emitters_join_signal)
+{
+  bb::emitter<int> first;
+  bb::signal<int> signal;
+  bb::connect(first, signal);
+
+  vector<int> received;
+  bb::slot<int> slot{[&](int value){ received.push_back(value); }};
+  bb::connect(signal, slot);
+
+  // Joining keeps the slot connected, unlike connecting.
+  bb::emitter<int> second;
+  bb::connect(second, signal, bb::join);
+  bb::connect(second, signal, bb::join);
+  first(1);
+  second(2);
+  EXPECT_EQ((vector<int>{1, 2}), received);
+
+  // Joining a signal without a state gives it one.
+  bb::emitter<int> third;
+  bb::signal<int> unconnected;
+  bb::connect(third, unconnected, bb::join);
+  bb::slot<int> other{[&](int value){ received.push_back(-value); }};
+  bb::connect(unconnected, other);
+  third(3);
+  EXPECT_EQ((vector<int>{1, 2, -3}), received);
+}
+
+// Check that one emitter can be joined to several signals, which it emits to
+// in the order they were joined.
+TEST(signals_test, emitter_joins_signals)
+{
+  bb::emitter<copy_counter> emit_signal;
+  bb::signal<copy_counter> signals[3];
+
+  vector<int> received;
+  deque<bb::slot<copy_counter>> slots;
+  for (int i = 0; i < 3; ++i)
+  {
+    bb::connect(emit_signal, signals[i], bb::join);
+    slots.emplace_back([&received, i](copy_counter){ received.push_back(i); });
+    bb::connect(signals[i], slots.back());
+  }
+
+  // Each signal but the last receives a copy, and the last one the
+  // original.
+  copy_counter counter;
+  auto copies = counter.copies;
+  emit_signal(std::move(counter));
+  EXPECT_EQ((vector<int>{0, 1, 2}), received);
+  EXPECT_EQ(2, *copies);
+
+  // Destroyed signals are skipped.
+  received.clear();
+  signals[1] = bb::signal<copy_counter>{};
+  emit_signal(copy_counter{});
+  EXPECT_EQ((vector<int>{0, 2}), received);
+
+  // Connecting replaces all of the emitter's signals.
+  received.clear();
+  bb::signal<copy_counter> replacement;
+  bb::connect(emit_signal, replacement);
+  emit_signal(copy_counter{});
+  EXPECT_TRUE(received.empty());
+}
+
+// Check that emit_to_last() delivers move-only arguments to the last joined
+// signal.
+TEST(signals_test, joined_move_only_arguments)
+{
+  bb::emitter<unique_ptr<int>> emit_signal;
+  bb::signal<unique_ptr<int>> first;
+  bb::signal<unique_ptr<int>> second;
+  bb::connect(emit_signal, first, bb::join);
+  bb::connect(emit_signal, second, bb::join);
+
+  int received = 0;
+  bb::slot<unique_ptr<int>> first_slot{
+    [&](unique_ptr<int> p){ received = -*p; }};
+  bb::slot<unique_ptr<int>> second_slot{
+    [&](unique_ptr<int> p){ received = *p; }};
+  bb::connect(first, first_slot);
+  bb::connect(second, second_slot);
+
+  emit_signal.emit_to_last(make_unique<int>(1));
+  EXPECT_EQ(1, received);
+}
+
+// Check that emit_to_last() only delivers copyable arguments to the last
+// connected slot, skipping any which have been disconnected.
+TEST(signals_test, emit_to_last)
+{
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  vector<int> first;
+  vector<int> last;
+  bb::slot<int> first_slot{[&](int value){ first.push_back(value); }};
+  bb::connect(signal, first_slot);
+  {
+    bb::slot<int> last_slot{[&](int value){ last.push_back(value); }};
+    bb::connect(signal, last_slot);
+
+    emit_signal.emit_to_last(1);
+    EXPECT_TRUE(first.empty());
+    EXPECT_EQ((vector<int>{1}), last);
+  }
+
+  emit_signal.emit_to_last(2);
+  EXPECT_EQ((vector<int>{2}), first);
+}
+
+// Check that a pinned emitter stops emitting once its signal is destroyed,
+// and that the signal's connections are released then rather than with the
+// emitter.
+TEST(signals_test, pinned_emitter)
+{
+  bb::emitter<int> emit_signal;
+  auto signal = make_unique<bb::signal<int>>();
+  bb::connect(emit_signal, *signal);
+  emit_signal.pin();
+
+  int received = 0;
+  auto captured = make_shared<int>(0);
+  bb::slot<int> slot{[&](int value){ received += value; }};
+  bb::connect(*signal, slot);
+  bb::connect(*signal, [&received, captured](int value){ received += value; });
+
+  auto copy = emit_signal;
+  emit_signal(1);
+  copy(2);
+  EXPECT_EQ(6, received);
+
+  signal.reset();
+  EXPECT_EQ(1, captured.use_count());
+  emit_signal(4);
+  copy(8);
+  EXPECT_EQ(6, received);
+
+  // Signals joined by a pinned emitter are pinned too.
+  bb::signal<int> joined;
+  bb::connect(emit_signal, joined, bb::join);
+  bb::connect(joined, slot);
+  emit_signal(16);
+  EXPECT_EQ(22, received);
+  joined = bb::signal<int>{};
+  emit_signal(32);
+  EXPECT_EQ(22, received);
+}
+
+// Check that a slot can destroy a pinned emitter and its signal during an
+// emit, and that the state outlives the emit.
+TEST(signals_test, pinned_emitter_destroyed_during_emit)
+{
+  auto emit_signal = make_unique<bb::emitter<int>>();
+  auto signal = make_unique<bb::signal<int>>();
+  bb::connect(*emit_signal, *signal);
+  emit_signal->pin();
+
+  int received = 0;
+  bb::connect(*signal, [&](int)
+  {
+    emit_signal.reset();
+    signal.reset();
+  });
+  bb::connect(*signal, [&](int value){ received += value; });
+
+  auto& emitter = *emit_signal;
+  emitter(1);
+  EXPECT_FALSE(emit_signal);
+  EXPECT_EQ(1, received);
+}
+
+// Check that pinned emitters can emit from several threads while their
+// signal is destroyed.
+TEST(signals_test, pinned_emitter_concurrent_destroy)
+{
+  for (int round = 0; round < 20; ++round)
+  {
+    bb::emitter<int> emit_signal;
+    auto signal = make_unique<bb::signal<int>>();
+    bb::connect(emit_signal, *signal);
+    emit_signal.pin();
+
+    atomic<int> received{0};
+    bb::slot<int> slot{bb::reentrant, [&](int value){ received += value; }};
+    bb::connect(*signal, slot);
+
+    atomic<bool> started{false};
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+      threads.emplace_back([&, emit_signal]() mutable
+      {
+        started = true;
+        for (int j = 0; j < 1000; ++j)
+          emit_signal(1);
+      });
+    }
+
+    while (!started)
+      this_thread::yield();
+    signal.reset();
+
+    for (auto& t : threads)
+      t.join();
+
+    auto total = received.load();
+    emit_signal(1);
+    EXPECT_EQ(total, received.load());
+  }
+}
+
+// Check that a parallel emit reaches every slot, across the pool's threads,
+// before it returns.
+TEST(signals_test, emit_parallel)
+{
+  bb::thread_pool_executor pool{4};
+  bb::emitter<const string&> emit_signal;
+  bb::signal<const string&> signal;
+  bb::connect(emit_signal, signal);
+
+  constexpr int count = 1000;
+  atomic<int> received{0};
+  deque<bb::slot<const string&>> slots;
+  for (int i = 0; i < count; ++i)
+  {
+    slots.emplace_back([&](const string& value)
+    {
+      EXPECT_EQ("event", value);
+      ++received;
+    });
+    bb::connect(signal, slots.back());
+  }
+
+  for (int round = 1; round <= 10; ++round)
+  {
+    emit_signal.emit_parallel(pool, "event");
+    EXPECT_EQ(round * count, received.load());
+  }
+
+  // Disconnected slots are skipped.
+  received = 0;
+  slots.resize(count / 2);
+  emit_signal.emit_parallel(pool, "event");
+  EXPECT_EQ(count / 2, received.load());
+}
+
+// Check that a parallel emit finishes on the calling thread if the executor
+// doesn't run anything in the meantime, and that the closures it submitted
+// are harmless when they run later.
+TEST(signals_test, emit_parallel_without_helpers)
+{
+  queue_executor executor;
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  int received = 0;
+  deque<bb::slot<int>> slots;
+  for (int i = 0; i < 100; ++i)
+  {
+    slots.emplace_back([&](int value){ received += value; });
+    bb::connect(signal, slots.back());
+  }
+
+  emit_signal.emit_parallel(executor, 1);
+  EXPECT_EQ(100, received);
+
+  signal = bb::signal<int>{};
+  executor.run();
+  EXPECT_EQ(100, received);
+}
+
+// Check that a slot which throws during a parallel emit stops it, and that
+// the exception only reaches the caller once no other thread is still
+// invoking slots.
+TEST(signals_test, emit_parallel_throwing_slot)
+{
+  bb::thread_pool_executor pool{4};
+  bb::emitter<int> emit_signal;
+  bb::signal<int> signal;
+  bb::connect(emit_signal, signal);
+
+  // Only the emitting thread throws, while the pool's threads are part way
+  // through their chunks.
+  const auto emitting_thread = std::this_thread::get_id();
+  atomic<bool> returned{false};
+  atomic<int> late{0};
+  deque<bb::slot<int>> slots;
+  for (int i = 0; i < 1000; ++i)
+  {
+    slots.emplace_back([&](int)
+    {
+      if (std::this_thread::get_id() == emitting_thread)
+        throw std::runtime_error{"slot"};
+
+      std::this_thread::sleep_for(std::chrono::microseconds{100});
+      if (returned)
+        ++late;
+    });
+    bb::connect(signal, slots.back());
+  }
+
+  EXPECT_THROW(emit_signal.emit_parallel(pool, 1), std::runtime_error);
+  returned = true;
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  EXPECT_EQ(0, late.load());
+}
+
+// Check that a queued signal holds events until its owner polls, and then
+// dispatches them in order, as one batch, to every local slot.
+TEST(signals_test, queued_signal_poll)
+{
+  bb::queued_signal<int, const string&> queued;
+  bb::emitter<int, const string&> emit_signal;
+  bb::connect(emit_signal, queued);
+
+  vector<int> received;
+  size_t batches = 0;
+  bb::queued_signal<int, const string&>::slot_t slot{
+    [&](int value, const string& text)
+    {
+      EXPECT_EQ(to_string(value), text);
+      received.push_back(value);
+    }};
+  bb::queued_signal<int, const string&>::slot_t batch_slot{bb::batched,
+    [&](bb::batch<int, const string&> events)
+    {
+      EXPECT_EQ(3u, events.size());
+      ++batches;
+    }};
+  bb::connect(queued.signal(), slot);
+  bb::connect(queued.signal(), batch_slot);
+
+  EXPECT_EQ(0u, queued.poll());
+  emit_signal(1, "1");
+  emit_signal(2, "2");
+  emit_signal(3, "3");
+  EXPECT_TRUE(received.empty());
+
+  EXPECT_EQ(3u, queued.poll());
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+  EXPECT_EQ(1u, batches);
+  EXPECT_EQ(0u, queued.poll());
+}
+
+// Check that events from several emitting threads are all dispatched on the
+// owning thread by run(), and that a local slot can stop it.
+TEST(signals_test, queued_signal_run)
+{
+  constexpr int producers = 4;
+  constexpr int count = 10000;
+  bb::queued_signal<int> queued{bb::bounded(64)};
+
+  const auto owner = this_thread::get_id();
+  long long sum = 0;
+  int received = 0;
+  bb::queued_signal<int>::slot_t slot{[&](int value)
+  {
+    EXPECT_EQ(owner, this_thread::get_id());
+    sum += value;
+    if (++received == producers * count)
+      queued.stop();
+  }};
+  bb::connect(queued.signal(), slot);
+
+  vector<thread> threads;
+  for (int i = 0; i < producers; ++i)
+  {
+    bb::emitter<int> emit_signal;
+    bb::connect(emit_signal, queued);
+    threads.emplace_back([emit_signal]() mutable
+    {
+      for (int j = 1; j <= count; ++j)
+        emit_signal(j);
+    });
+  }
+
+  queued.run();
+  for (auto& t : threads)
+    t.join();
+
+  EXPECT_EQ(producers * count, received);
+  EXPECT_EQ(producers * (count * (count + 1LL) / 2), sum);
+}
+
+// Check that a stop() issued before run() still lets run() dispatch what's
+// already queued.
+TEST(signals_test, queued_signal_stop_before_run)
+{
+  bb::queued_signal<int> queued;
+  bb::emitter<int> emit_signal;
+  bb::connect(emit_signal, queued);
+
+  vector<int> received;
+  bb::queued_signal<int>::slot_t slot{[&](int value)
+  {
+    received.push_back(value);
+  }};
+  bb::connect(queued.signal(), slot);
+
+  emit_signal(1);
+  emit_signal(2);
+  queued.stop();
+  queued.run();
+  EXPECT_EQ((vector<int>{1, 2}), received);
+
+  // The stop was consumed, and an emit afterwards waits for the next call.
+  emit_signal(3);
+  EXPECT_EQ(1u, queued.poll());
+  EXPECT_EQ((vector<int>{1, 2, 3}), received);
+}
+
+// Check what a queued signal does with emits when its ring is full, and that
+// destroying it releases an emitter which is blocked on it.
+TEST(signals_test, queued_signal_overflow)
+{
+  vector<int> received;
+  auto record = [&](int value){ received.push_back(value); };
+
+  {
+    bb::queued_signal<int> queued{bb::bounded(2, bb::overflow::drop_newest)};
+    bb::emitter<int> emit_signal;
+    bb::connect(emit_signal, queued);
+    bb::queued_signal<int>::slot_t slot{record};
+    bb::connect(queued.signal(), slot);
+
+    for (int i = 1; i <= 4; ++i)
+      emit_signal(i);
+    queued.poll();
+    EXPECT_EQ((vector<int>{1, 2}), received);
+    EXPECT_EQ(2u, queued.overflow_count());
+  }
+
+  received.clear();
+  {
+    bb::queued_signal<int> queued{bb::bounded(2, bb::overflow::drop_oldest)};
+    bb::emitter<int> emit_signal;
+    bb::connect(emit_signal, queued);
+    bb::queued_signal<int>::slot_t slot{record};
+    bb::connect(queued.signal(), slot);
+
+    for (int i = 1; i <= 4; ++i)
+      emit_signal(i);
+    queued.poll();
+    EXPECT_EQ((vector<int>{3, 4}), received);
+  }
+
+  bb::emitter<int> emit_signal;
+  thread blocked;
+  {
+    bb::queued_signal<int> queued{bb::bounded(1)};
+    bb::connect(emit_signal, queued);
+    emit_signal(1);
+    blocked = thread{[emit_signal]() mutable { emit_signal(2); }};
+    while (queued.overflow_count() == 0)
+      this_thread::yield();
+  }
+  blocked.join();
+  emit_signal(3);
+}
+
+// Check that a connection group disconnects all of its functions, across
+// signals, at once, and that the signals release them straight away.
+TEST(signals_test, connection_group_disconnects)
+{
+  bb::emitter<int> emit_int;
+  bb::signal<int> int_signal;
+  bb::connect(emit_int, int_signal);
+  bb::emitter<> emit_void;
+  bb::signal<> void_signal;
+  bb::connect(emit_void, void_signal);
+
+  int received = 0;
+  auto alive = std::make_shared<bool>(true);
+  std::weak_ptr<bool> weak_alive{alive};
+
+  bb::connection_group group;
+  bb::connection first = bb::connect(int_signal,
+    [&received, alive](int value){ received += value; }, group);
+  bb::connect(int_signal, [&received](int value){ received += value; },
+              bb::priority{1}, group);
+  bb::connect(void_signal, [&received, alive]{ ++received; }, group);
+  alive.reset();
+
+  // A function outside the group is unaffected by it.
+  int outside = 0;
+  bb::connect(int_signal, [&outside](int){ ++outside; });
+
+  emit_int(10);
+  emit_void();
+  EXPECT_EQ(21, received);
+  EXPECT_TRUE(first.connected());
+
+  group.disconnect();
+  EXPECT_FALSE(first.connected());
+
+  // Both signals were left mostly tombstones, so they compacted, which
+  // destroyed the functions.
+  EXPECT_TRUE(weak_alive.expired());
+
+  emit_int(10);
+  emit_void();
+  EXPECT_EQ(21, received);
+  EXPECT_EQ(2, outside);
+
+  // The group can be reused, and disconnects again when it's destroyed.
+  {
+    bb::connection_group scoped = std::move(group);
+    bb::connect(int_signal, [&received](int value){ received += value; },
+                scoped);
+    emit_int(1);
+    EXPECT_EQ(22, received);
+  }
+
+  emit_int(1);
+  EXPECT_EQ(22, received);
+  EXPECT_EQ(4, outside);
+}
+
+// Check that a slot can join a group, which disconnects it from every signal,
+// and that a slot which is already connected outside the group can't join.
+TEST(signals_test, connection_group_slots)
+{
+  bb::emitter<int> emit_first;
+  bb::signal<int> first;
+  bb::connect(emit_first, first);
+  bb::emitter<int> emit_second;
+  bb::signal<int> second;
+  bb::connect(emit_second, second);
+
+  int received = 0;
+  bb::slot<int> grouped{[&](int value){ received += value; }};
+  bb::slot<int> ungrouped{[&](int value){ received += value * 100; }};
+
+  bb::connection_group group;
+  bb::connect(first, grouped, group);
+  bb::connect(second, grouped, bb::priority{1}, group);
+
+  bb::connect(first, ungrouped);
+  bb::connect(second, ungrouped, group);
+
+  emit_first(1);
+  emit_second(2);
+  EXPECT_EQ(103, received);
+
+  group.disconnect();
+  emit_first(1);
+  emit_second(2);
+  EXPECT_EQ(203, received);
+
+  // A slot in a disconnected group stays disconnected.
+  bb::connect(first, grouped);
+  emit_first(1);
+  EXPECT_EQ(303, received);
+}
+
+// Check that disconnecting a group waits for invocations in other threads,
+// so that none of its functions are running once it returns.
+TEST(signals_test, connection_group_waits_for_invocations)
+{
+  bb::emitter<> emit_signal;
+  bb::signal<> signal;
+  bb::connect(emit_signal, signal);
+
+  std::atomic<bool> running{false};
+  std::atomic<bool> disconnected{false};
+  std::atomic<int> late{0};
+
+  bb::connection_group group;
+  for (int i = 0; i < 10; ++i)
+  {
+    bb::connect(signal, [&]
+    {
+      running.store(true);
+      this_thread::sleep_for(chrono::microseconds(10));
+      if (disconnected.load())
+        ++late;
+    }, group);
+  }
+
+  std::atomic<bool> stop{false};
+  thread emitter_thread{[&]
+  {
+    while (!stop.load())
+      emit_signal();
+  }};
+
+  while (!running.load())
+    this_thread::yield();
+
+  group.disconnect();
+  disconnected.store(true);
+
+  stop.store(true);
+  emitter_thread.join();
+  EXPECT_EQ(0, late.load());
+}
+
 //------------------------------------------------------------------------------
 
 }